@@ -0,0 +1,273 @@
+/**
+ * File: decimate.c
+ * Description: Polyphase FIR decimator used as an optional multirate front-end
+ *              of the Welch method. Large factors are split into a cascade of
+ *              small stages, each one filtering with a Blackman-windowed sinc
+ *              low-pass filter and evaluating only every factor-th output.
+ *              The filter is 6 dB down at the reduced Nyquist frequency, flat
+ *              within 0.01 dB up to 80% of it, and attenuates by more than
+ *              70 dB everything that would alias into the lower 80% of the
+ *              reduced band. Only that part of the estimate is returned,
+ *              unless the factor is 1 and nothing is filtered.
+ *
+ * Author: Xiaojun Wu <xiaojun.wu@nyu.edu>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "welch.h"
+
+#define PI 3.1415926535897932384626
+
+#define DECIMATE_MAX_STAGE 8   /* Largest factor handled by a single stage */
+#define DECIMATE_HALF_TAPS 16  /* Half filter length in units of factor */
+#define DECIMATE_CUTOFF 1.0    /* -6 dB point relative to reduced Nyquist */
+#define DECIMATE_PASSBAND 0.8  /* Band of the estimate returned by
+                                  welchDecimated(), relative to the reduced
+                                  Nyquist frequency */
+
+/**
+ * Design the anti-aliasing low-pass filter of one decimation stage. The filter
+ * is symmetric with odd length, so it has no phase shift around its center.
+ */
+static welchStatus_t designLowpass(int factor, double **h, int *lenH)
+{
+    double cutoff;  /* Cut-off frequency in cycles per input sample */
+    double sum;     /* DC gain, used to normalize the filter */
+    double t;       /* Offset of a tap from the filter center */
+    int center;     /* Index of the center tap */
+    int i;
+
+    *lenH = 2 * DECIMATE_HALF_TAPS * factor + 1;
+    center = DECIMATE_HALF_TAPS * factor;
+    cutoff = DECIMATE_CUTOFF * 0.5 / factor;
+
+    *h = (double*) malloc(*lenH * sizeof(double));
+    if (*h == NULL) {
+        fprintf(stderr, "Error in decimate(): Failed to allocate memory.\n");
+
+        return WELCH_FAILURE;
+    }
+
+    sum = 0.0;
+    for (i = 0; i < *lenH; ++i) {
+        t = i - center;
+        if (i == center) {
+            (*h)[i] = 2 * cutoff;
+        } else {
+            (*h)[i] = sin(2 * PI * cutoff * t) / (PI * t);
+        }
+        (*h)[i] *= 0.42 - 0.5 * cos(2 * PI * i / (*lenH - 1))
+                   + 0.08 * cos(4 * PI * i / (*lenH - 1));
+        sum += (*h)[i];
+    }
+
+    for (i = 0; i < *lenH; ++i) {
+        (*h)[i] /= sum;
+    }
+
+    return WELCH_SUCCESS;
+}
+
+/**
+ * Sample i of x, extended beyond both ends by odd reflection
+ */
+static double extended(double *x, int n, int i)
+{
+    if (n == 1) {
+        return x[0];
+    }
+
+    if (i < 0) {
+        return 2 * x[0] - extended(x, n, -i);
+    }
+
+    if (i >= n) {
+        return 2 * x[n - 1] - extended(x, n, 2 * (n - 1) - i);
+    }
+
+    return x[i];
+}
+
+/**
+ * Run one decimation stage. Only the outputs that survive downsampling are
+ * computed, which is the polyphase form of filtering followed by discarding
+ * factor - 1 out of every factor samples. Away from the edges each output is
+ * a contiguous dot product so the compiler can vectorize it.
+ */
+static welchStatus_t decimateStage(double *x, int n, int factor, double *y,
+                                   int *lenY)
+{
+    double *h;    /* Anti-aliasing filter */
+    int lenH;     /* Length of the filter */
+    int half;     /* Number of taps on each side of the center */
+    int start;    /* First input sample covered by the filter */
+    double acc;   /* Accumulator of a single output */
+    int m, k;
+    welchStatus_t status;
+
+    status = designLowpass(factor, &h, &lenH);
+    if (status != WELCH_SUCCESS) {
+        return WELCH_FAILURE;
+    }
+
+    half = (lenH - 1) / 2;
+    *lenY = n / factor;
+
+    for (m = 0; m < *lenY; ++m) {
+        start = m * factor - half;
+        acc = 0.0;
+
+        if (start >= 0 && start + lenH <= n) {
+            #pragma omp simd reduction(+:acc)
+            for (k = 0; k < lenH; ++k) {
+                acc += h[k] * x[start + k];
+            }
+        } else {
+            /* Extend the signal by point reflection about its end points,
+             * which keeps its value and slope continuous and so avoids the
+             * broadband transient of padding with 0 */
+            for (k = 0; k < lenH; ++k) {
+                acc += h[k] * extended(x, n, start + k);
+            }
+        }
+
+        y[m] = acc;
+    }
+
+    free(h);
+
+    return WELCH_SUCCESS;
+}
+
+welchStatus_t decimate(double *x, int n, int factor, double **y, int *lenY)
+{
+    double *current;  /* Input of the current stage */
+    double *next;     /* Output of the current stage */
+    int lenCurrent;   /* Length of current */
+    int lenNext;      /* Length of next */
+    int stage;        /* Factor of the current stage */
+    welchStatus_t status;
+
+    if (factor <= 0) {
+        fprintf(stderr, "Error in decimate(): Decimation factor must be "
+                "positive.\n");
+
+        return WELCH_FAILURE;
+    }
+
+    if (n / factor <= 0) {
+        fprintf(stderr, "Error in decimate(): Signal is shorter than the "
+                "decimation factor.\n");
+
+        return WELCH_FAILURE;
+    }
+
+    /* A factor of 1 leaves the signal untouched */
+    if (factor == 1) {
+        status = padZero(x, n, y, n);
+        *lenY = n;
+
+        return status;
+    }
+
+    /* The first stage reads x directly, so at most the outputs of two
+     * consecutive stages are allocated at once */
+    current = x;
+    lenCurrent = n;
+
+    while (factor > 1) {
+        /* Use the largest small divisor as the factor of this stage, so that
+         * every stage keeps a short filter. A prime factor larger than
+         * DECIMATE_MAX_STAGE has to be handled in one stage. */
+        for (stage = DECIMATE_MAX_STAGE; stage > 1; --stage) {
+            if (factor % stage == 0) {
+                break;
+            }
+        }
+        if (stage == 1) {
+            stage = factor;
+        }
+
+        next = (double*) malloc(lenCurrent / stage * sizeof(double));
+        if (next == NULL) {
+            fprintf(stderr, "Error in decimate(): Failed to allocate "
+                    "memory.\n");
+
+            if (current != x) {
+                free(current);
+            }
+
+            return WELCH_FAILURE;
+        }
+
+        status = decimateStage(current, lenCurrent, stage, next, &lenNext);
+        if (current != x) {
+            free(current);
+        }
+        if (status != WELCH_SUCCESS) {
+            free(next);
+
+            return WELCH_FAILURE;
+        }
+
+        current = next;
+        lenCurrent = lenNext;
+        factor /= stage;
+    }
+
+    *y = current;
+    *lenY = lenCurrent;
+
+    return WELCH_SUCCESS;
+}
+
+welchStatus_t welchDecimated(double *signal, double **Pxx, double **frequency,
+                             double samplingFrequency, int lenSignal,
+                             int lenSegment, int lenOverlap, int *lenPxx,
+                             char *windowType, char *fftType, int nfft,
+                             int decimationFactor)
+{
+    double *decimated;          /* Signal at the reduced sampling rate */
+    int lenDecimated;           /* Length of decimated */
+    double *PxxInternal;        /* Estimate over the whole reduced band */
+    double *frequencyInternal;  /* Frequencies of PxxInternal */
+    int lenPxxInternal;         /* Length of PxxInternal */
+    double edge;                /* Highest frequency returned */
+    int i;
+    welchStatus_t status;
+
+    status = decimate(signal, lenSignal, decimationFactor, &decimated,
+                      &lenDecimated);
+    if (status != WELCH_SUCCESS) {
+        return WELCH_FAILURE;
+    }
+
+    /* Frequencies and the density scale follow from the reduced rate */
+    status = welch(decimated, &PxxInternal, &frequencyInternal,
+                   samplingFrequency / decimationFactor, lenDecimated,
+                   lenSegment, lenOverlap, &lenPxxInternal, windowType,
+                   fftType, nfft);
+
+    free(decimated);
+
+    if (status != WELCH_SUCCESS) {
+        return WELCH_FAILURE;
+    }
+
+    /* Drop the frequencies near the reduced Nyquist frequency, which are
+     * attenuated by the filter and may hold aliases. Without decimation no
+     * filter is applied and the whole band is kept. */
+    i = lenPxxInternal;
+    if (decimationFactor > 1) {
+        edge = DECIMATE_PASSBAND * samplingFrequency / decimationFactor / 2;
+        for (i = 0; i < lenPxxInternal && frequencyInternal[i] <= edge; ++i) {
+        }
+    }
+
+    *Pxx = PxxInternal;
+    *frequency = frequencyInternal;
+    *lenPxx = i;
+
+    return WELCH_SUCCESS;
+}
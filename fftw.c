@@ -63,3 +63,118 @@ welchStatus_t fftw(double *x, int n, double *xfft, int nfft, int useOpenMP)
 
     return WELCH_SUCCESS;
 }
+
+welchStatus_t fftwCreatePlan(fftwPlan_t *plan, int nfft, int howmany,
+                             int useOpenMP)
+{
+    int lenComplex;  /* Number of complex outputs of a single transform */
+
+    if (nfft <= 0 || howmany <= 0) {
+        fprintf(stderr, "Error in fftwCreatePlan(): Number of FFT points and "
+                "transforms must be positive.\n");
+
+        return WELCH_FAILURE;
+    }
+
+    lenComplex = nfft / 2 + 1;
+
+    plan->in = (double*) fftw_malloc(nfft * howmany * sizeof(double));
+    if (plan->in == NULL) {
+        fprintf(stderr, "Failed to allocate memory in fftwCreatePlan()\n");
+
+        return WELCH_FAILURE;
+    }
+
+    plan->out = fftw_malloc(lenComplex * howmany * sizeof(fftw_complex));
+    if (plan->out == NULL) {
+        fprintf(stderr, "Failed to allocate memory in fftwCreatePlan()\n");
+
+        fftw_free(plan->in);
+
+        return WELCH_FAILURE;
+    }
+
+    fftw_init_threads();
+    fftw_plan_with_nthreads(useOpenMP ? omp_get_max_threads() : 1);
+    plan->plan = fftw_plan_many_dft_r2c(1, &nfft, howmany, plan->in, NULL, 1,
+                                        nfft, (fftw_complex*) plan->out, NULL,
+                                        1, lenComplex, FFTW_ESTIMATE);
+    if (plan->plan == NULL) {
+        fprintf(stderr, "Error in fftwCreatePlan(): Failed to create plan\n");
+
+        fftw_free(plan->in);
+        fftw_free(plan->out);
+
+        return WELCH_FAILURE;
+    }
+
+    plan->nfft = nfft;
+    plan->howmany = howmany;
+
+    return WELCH_SUCCESS;
+}
+
+welchStatus_t fftwExecute(fftwPlan_t *plan, double *x, int n, double *xfft)
+{
+    double *in;  /* Input of the current transform */
+    int nfft;
+    int b, i;
+
+    nfft = plan->nfft;
+
+    if (n > nfft) {
+        fprintf(stderr, "Error in fftwExecute(): The input array has larger "
+                "size than nfft.\n");
+
+        return WELCH_FAILURE;
+    }
+
+    /* Copy x into the planned buffer and pad it with 0 */
+    for (b = 0; b < plan->howmany; ++b) {
+        in = plan->in + b * nfft;
+        for (i = 0; i < n; ++i) {
+            in[i] = x[b * n + i];
+        }
+        for (; i < nfft; ++i) {
+            in[i] = 0.0;
+        }
+    }
+
+    fftwExecuteInput(plan, xfft);
+
+    return WELCH_SUCCESS;
+}
+
+void fftwExecuteInput(fftwPlan_t *plan, double *xfft)
+{
+    fftw_complex *xfftComplex;  /* Output of the current transform */
+    double *out;                /* xfft of the current transform */
+    int nfft;
+    int b, i;
+
+    nfft = plan->nfft;
+
+    fftw_execute((fftw_plan) plan->plan);
+
+    /* Convert complex results to real */
+    for (b = 0; b < plan->howmany; ++b) {
+        xfftComplex = (fftw_complex*) plan->out + b * (nfft / 2 + 1);
+        out = xfft + b * nfft;
+
+        out[0] = xfftComplex[0][0];
+        for (i = 1; i <= (nfft - 1) / 2; ++i) {
+            out[2 * i - 1] = xfftComplex[i][0];
+            out[2 * i] = xfftComplex[i][1];
+        }
+        if (nfft % 2 == 0) {
+            out[nfft - 1] = xfftComplex[nfft / 2][0];
+        }
+    }
+}
+
+void fftwDestroyPlan(fftwPlan_t *plan)
+{
+    fftw_destroy_plan((fftw_plan) plan->plan);
+    fftw_free(plan->in);
+    fftw_free(plan->out);
+}
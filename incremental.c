@@ -0,0 +1,317 @@
+/**
+ * File: incremental.c
+ * Description: Implements incremental re-analysis with the Welch method. The
+ *              periodogram of every segment is cached together with a hash of
+ *              its samples, and the running sum of all periodograms is kept.
+ *              After an edit of the signal only the segments overlapping the
+ *              edited range are recomputed, and the sum is patched.
+ *
+ * Author: Xiaojun Wu <xiaojun.wu@nyu.edu>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "welch.h"
+
+#define CACHE_RESUM 4096  /* Patched segments before the sum is rebuilt */
+
+struct welchCache_s {
+    double *spectra;        /* Unscaled periodogram of every segment */
+    uint64_t *hashes;       /* Hash of the samples of every segment */
+    double *PxxSum;         /* Sum of all periodograms */
+    double *spectrum;       /* Scratch periodogram */
+    double *window;
+    double *windowedSignal;
+    double *signalfft;
+    fftwPlan_t plan;
+    long numPatched;        /* Segments patched since the sum was rebuilt */
+    double samplingFrequency;
+    double normSquared;
+    int lenSignal;
+    int lenSegment;
+    int lenHop;
+    int numSegment;
+    int lenPxx;
+    int nfft;
+};
+
+/**
+ * 64-bit FNV-1a hash of an array of samples
+ */
+static uint64_t hashSamples(double *x, int n)
+{
+    unsigned char *bytes = (unsigned char*) x;
+    uint64_t hash = 14695981039346656037ULL;
+    size_t i;
+
+    for (i = 0; i < n * sizeof(double); ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/**
+ * Compute the unscaled periodogram of a segment into cache->spectrum
+ */
+static welchStatus_t computeSegment(welchCache_t *cache, double *segment)
+{
+    int j;
+
+    for (j = 0; j < cache->lenSegment; ++j) {
+        cache->windowedSignal[j] = segment[j] * cache->window[j];
+    }
+
+    if (fftwExecute(&cache->plan, cache->windowedSignal, cache->lenSegment,
+                    cache->signalfft) != WELCH_SUCCESS) {
+        return WELCH_FAILURE;
+    }
+
+    for (j = 0; j < cache->lenPxx; ++j) {
+        cache->spectrum[j] = 0.0;
+    }
+    addPeriodogram(cache->signalfft, cache->nfft, cache->spectrum);
+
+    return WELCH_SUCCESS;
+}
+
+/**
+ * Rebuild the sum of periodograms from the cached ones, which removes the
+ * rounding errors accumulated by patching
+ */
+static void resum(welchCache_t *cache)
+{
+    double *spectrum;
+    int i, j;
+
+    for (j = 0; j < cache->lenPxx; ++j) {
+        cache->PxxSum[j] = 0.0;
+    }
+
+    for (i = 0; i < cache->numSegment; ++i) {
+        spectrum = cache->spectra + (long) i * cache->lenPxx;
+        for (j = 0; j < cache->lenPxx; ++j) {
+            cache->PxxSum[j] += spectrum[j];
+        }
+    }
+
+    cache->numPatched = 0;
+}
+
+welchStatus_t welchCacheCreate(welchCache_t **cache, double *signal,
+                               double samplingFrequency, int lenSignal,
+                               int lenSegment, int lenOverlap,
+                               char *windowType, int nfft)
+{
+    welchCache_t *c;
+    int i;
+
+    /* Check inputs */
+    if (samplingFrequency <= 0 || lenSegment <= 0 || lenOverlap < 0
+        || lenOverlap >= lenSegment || nfft < lenSegment
+        || lenSignal < lenSegment) {
+        fprintf(stderr, "Error in welchCacheCreate(): Invalid "
+                "parameters.\n");
+
+        return WELCH_FAILURE;
+    }
+
+    if ((lenSignal - lenOverlap) % (lenSegment - lenOverlap) != 0) {
+        fprintf(stderr, "Unable to determine integral number of segments.\n");
+
+        return WELCH_FAILURE;
+    }
+
+    c = (welchCache_t*) calloc(1, sizeof(welchCache_t));
+    if (c == NULL) {
+        fprintf(stderr, "Failed to allocate memory in welchCacheCreate().\n");
+
+        return WELCH_FAILURE;
+    }
+
+    c->samplingFrequency = samplingFrequency;
+    c->lenSignal = lenSignal;
+    c->lenSegment = lenSegment;
+    c->lenHop = lenSegment - lenOverlap;
+    c->numSegment = (lenSignal - lenOverlap) / c->lenHop;
+    c->nfft = nfft;
+    c->lenPxx = nfft % 2 == 0 ? nfft / 2 + 1 : (nfft + 1) / 2;
+
+    c->spectra = (double*) malloc((long) c->numSegment * c->lenPxx
+                                  * sizeof(double));
+    c->hashes = (uint64_t*) malloc(c->numSegment * sizeof(uint64_t));
+    c->PxxSum = (double*) malloc(c->lenPxx * sizeof(double));
+    c->spectrum = (double*) malloc(c->lenPxx * sizeof(double));
+    c->window = (double*) malloc(lenSegment * sizeof(double));
+    c->windowedSignal = (double*) malloc(lenSegment * sizeof(double));
+    c->signalfft = (double*) malloc(nfft * sizeof(double));
+    if (c->spectra == NULL || c->hashes == NULL || c->PxxSum == NULL
+        || c->spectrum == NULL || c->window == NULL
+        || c->windowedSignal == NULL || c->signalfft == NULL) {
+        fprintf(stderr, "Failed to allocate memory in welchCacheCreate().\n");
+
+        welchCacheDestroy(c);
+
+        return WELCH_FAILURE;
+    }
+
+    if (getWindow(windowType, c->window, lenSegment) != WELCH_SUCCESS) {
+        welchCacheDestroy(c);
+
+        return WELCH_FAILURE;
+    }
+
+    c->normSquared = 0.0;
+    for (i = 0; i < lenSegment; ++i) {
+        c->normSquared += c->window[i] * c->window[i];
+    }
+
+    if (fftwCreatePlan(&c->plan, nfft, 1, 0) != WELCH_SUCCESS) {
+        welchCacheDestroy(c);
+
+        return WELCH_FAILURE;
+    }
+
+    /* Compute and cache every segment */
+    for (i = 0; i < c->numSegment; ++i) {
+        if (computeSegment(c, signal + (long) i * c->lenHop)
+            != WELCH_SUCCESS) {
+            welchCacheDestroy(c);
+
+            return WELCH_FAILURE;
+        }
+
+        memcpy(c->spectra + (long) i * c->lenPxx, c->spectrum,
+               c->lenPxx * sizeof(double));
+        c->hashes[i] = hashSamples(signal + (long) i * c->lenHop, lenSegment);
+    }
+
+    resum(c);
+
+    *cache = c;
+
+    return WELCH_SUCCESS;
+}
+
+welchStatus_t welchCacheUpdate(welchCache_t *cache, double *signal,
+                               int dirtyStart, int dirtyEnd,
+                               int *numRecomputed)
+{
+    double *cached;     /* Cached periodogram of the current segment */
+    double *segment;    /* Samples of the current segment */
+    uint64_t hash;
+    int first, last;    /* Segments overlapping [dirtyStart, dirtyEnd) */
+    int count;
+    int i, j;
+
+    if (dirtyStart < 0) {
+        dirtyStart = 0;
+    }
+    if (dirtyEnd > cache->lenSignal) {
+        dirtyEnd = cache->lenSignal;
+    }
+
+    count = 0;
+
+    if (dirtyStart < dirtyEnd) {
+        /* Segment i covers [i * lenHop, i * lenHop + lenSegment) */
+        first = 0;
+        if (dirtyStart - cache->lenSegment + 1 > 0) {
+            first = (dirtyStart - cache->lenSegment + cache->lenHop)
+                    / cache->lenHop;
+        }
+        last = (dirtyEnd - 1) / cache->lenHop;
+        if (last > cache->numSegment - 1) {
+            last = cache->numSegment - 1;
+        }
+
+        for (i = first; i <= last; ++i) {
+            segment = signal + (long) i * cache->lenHop;
+
+            /* Segments whose samples are unchanged keep their periodogram */
+            hash = hashSamples(segment, cache->lenSegment);
+            if (hash == cache->hashes[i]) {
+                continue;
+            }
+
+            if (computeSegment(cache, segment) != WELCH_SUCCESS) {
+                return WELCH_FAILURE;
+            }
+
+            /* Replace the old periodogram in the sum */
+            cached = cache->spectra + (long) i * cache->lenPxx;
+            for (j = 0; j < cache->lenPxx; ++j) {
+                cache->PxxSum[j] += cache->spectrum[j] - cached[j];
+                cached[j] = cache->spectrum[j];
+            }
+            cache->hashes[i] = hash;
+
+            ++count;
+        }
+
+        /* Rebuilding is cheaper than patching most segments, and exact */
+        cache->numPatched += count;
+        if (cache->numPatched >= CACHE_RESUM
+            || count > cache->numSegment / 2) {
+            resum(cache);
+        }
+    }
+
+    if (numRecomputed != NULL) {
+        *numRecomputed = count;
+    }
+
+    return WELCH_SUCCESS;
+}
+
+welchStatus_t welchCacheGetPxx(welchCache_t *cache, double **Pxx,
+                               double **frequency, int *lenPxx)
+{
+    double *PxxInternal;        /* Pxx is only touched on success */
+    double *frequencyInternal;  /* Similar purpose, but for frequency */
+    int i;
+
+    PxxInternal = (double*) malloc(cache->lenPxx * sizeof(double));
+    frequencyInternal = (double*) malloc(cache->lenPxx * sizeof(double));
+    if (PxxInternal == NULL || frequencyInternal == NULL) {
+        fprintf(stderr, "Failed to allocate memory in welchCacheGetPxx().\n");
+
+        free(PxxInternal);
+        free(frequencyInternal);
+
+        return WELCH_FAILURE;
+    }
+
+    memcpy(PxxInternal, cache->PxxSum, cache->lenPxx * sizeof(double));
+    scalePeriodogram(PxxInternal, cache->nfft,
+                     1.0 / (cache->samplingFrequency * cache->normSquared
+                            * cache->numSegment));
+
+    for (i = 0; i < cache->lenPxx; ++i) {
+        frequencyInternal[i] = i * cache->samplingFrequency / cache->nfft;
+    }
+
+    *Pxx = PxxInternal;
+    *frequency = frequencyInternal;
+    *lenPxx = cache->lenPxx;
+
+    return WELCH_SUCCESS;
+}
+
+void welchCacheDestroy(welchCache_t *cache)
+{
+    if (cache->plan.plan != NULL) {
+        fftwDestroyPlan(&cache->plan);
+    }
+
+    free(cache->spectra);
+    free(cache->hashes);
+    free(cache->PxxSum);
+    free(cache->spectrum);
+    free(cache->window);
+    free(cache->windowedSignal);
+    free(cache->signalfft);
+    free(cache);
+}
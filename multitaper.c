@@ -0,0 +1,529 @@
+/**
+ * File: multitaper.c
+ * Description: Implements Thomson's multitaper method for signals of real
+ *              numbers. The discrete prolate spheroidal sequences (DPSS) used
+ *              as tapers are computed once for a given length and time
+ *              half-bandwidth product and cached, and all tapered copies of
+ *              the signal are transformed by a single batched FFT.
+ *
+ * Author: Xiaojun Wu <xiaojun.wu@nyu.edu>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "welch.h"
+
+#define PI 3.1415926535897932384626
+
+#define DPSS_BISECTION 200       /* Maximal number of bisection steps */
+#define DPSS_INVERSE_ITERATION 3 /* Steps of inverse iteration */
+#define ADAPTIVE_ITERATION 100   /* Maximal steps of adaptive weighting */
+#define ADAPTIVE_TOLERANCE 1e-10 /* Relative change to stop adaptation */
+
+/**
+ * Tapers of the last call. Also keeps the batched FFT plan, which depends on
+ * nfft and the number of tapers.
+ */
+static struct {
+    double *tapers;  /* numTaper tapers of length lenSignal, one after another */
+    double *lambda;  /* Concentration of each taper in the band [-W, W] */
+    int lenSignal;
+    double halfBandwidth;
+    int numTaper;
+
+    fftwPlan_t plan;
+    int hasPlan;
+    int nfft;
+    int useOpenMP;
+} cache;
+
+/**
+ * Number of eigenvalues of the symmetric tridiagonal matrix with diagonal d
+ * and off-diagonal e (e[0] unused) that are smaller than x
+ */
+static int sturmCount(double *d, double *e, int n, double x)
+{
+    double q;
+    int count;
+    int i;
+
+    count = 0;
+    q = 1.0;
+    for (i = 0; i < n; ++i) {
+        if (i == 0) {
+            q = d[i] - x;
+        } else {
+            q = d[i] - x - e[i] * e[i] / q;
+        }
+        if (q == 0.0) {
+            q = -DBL_EPSILON * (fabs(x) + 1.0);
+        }
+        if (q < 0.0) {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Solve the tridiagonal system (dl, d, du) x = b in place in b, with partial
+ * pivoting. dl, d and du are overwritten, and du2 holds the fill-in.
+ */
+static void solveTridiagonal(double *dl, double *d, double *du, double *du2,
+                             double *b, int n, double tiny)
+{
+    double fact, temp;
+    int i;
+
+    for (i = 0; i < n - 1; ++i) {
+        if (fabs(d[i]) >= fabs(dl[i])) {
+            /* No row interchange */
+            if (d[i] == 0.0) {
+                d[i] = tiny;
+            }
+            fact = dl[i] / d[i];
+            d[i + 1] -= fact * du[i];
+            b[i + 1] -= fact * b[i];
+            du2[i] = 0.0;
+        } else {
+            /* Interchange rows i and i + 1 */
+            fact = d[i] / dl[i];
+            d[i] = dl[i];
+            temp = d[i + 1];
+            d[i + 1] = du[i] - fact * temp;
+            if (i < n - 2) {
+                du2[i] = du[i + 1];
+                du[i + 1] = -fact * du2[i];
+            } else {
+                du2[i] = 0.0;
+            }
+            du[i] = temp;
+            temp = b[i];
+            b[i] = b[i + 1];
+            b[i + 1] = temp - fact * b[i + 1];
+        }
+    }
+    if (d[n - 1] == 0.0) {
+        d[n - 1] = tiny;
+    }
+
+    /* Back substitution */
+    b[n - 1] /= d[n - 1];
+    if (n > 1) {
+        b[n - 2] = (b[n - 2] - du[n - 2] * b[n - 1]) / d[n - 2];
+    }
+    for (i = n - 3; i >= 0; --i) {
+        b[i] = (b[i] - du[i] * b[i + 1] - du2[i] * b[i + 2]) / d[i];
+    }
+}
+
+/**
+ * Concentration of a unit energy taper in [-W, W], computed from its
+ * autocorrelation, which is obtained by transforming its power spectrum
+ */
+static welchStatus_t concentration(double *taper, int n, double w,
+                                   double *lambda)
+{
+    fftwPlan_t plan;  /* Transform of length 2 * n, no wrap-around */
+    double *xfft;     /* Packed transform */
+    double *power;    /* Power spectrum, later autocorrelation */
+    int m;            /* Length of the transforms */
+    int k;
+
+    m = 2 * n;
+    xfft = (double*) malloc(m * sizeof(double));
+    power = (double*) malloc(m * sizeof(double));
+    if (xfft == NULL || power == NULL) {
+        fprintf(stderr, "Failed to allocate memory in multitaper().\n");
+
+        free(xfft);
+        free(power);
+
+        return WELCH_FAILURE;
+    }
+
+    if (fftwCreatePlan(&plan, m, 1, 0) != WELCH_SUCCESS) {
+        free(xfft);
+        free(power);
+
+        return WELCH_FAILURE;
+    }
+
+    /* Power spectrum over all m frequencies, which is real and even */
+    fftwExecute(&plan, taper, n, xfft);
+    power[0] = xfft[0] * xfft[0];
+    for (k = 1; k < n; ++k) {
+        power[k] = xfft[2 * k - 1] * xfft[2 * k - 1]
+                   + xfft[2 * k] * xfft[2 * k];
+        power[m - k] = power[k];
+    }
+    power[n] = xfft[m - 1] * xfft[m - 1];
+
+    /* Its transform is m times the autocorrelation, and it is real */
+    fftwExecute(&plan, power, m, xfft);
+
+    *lambda = 2 * w * xfft[0] / m;
+    for (k = 1; k < n; ++k) {
+        *lambda += 2 * sin(2 * PI * w * k) / (PI * k) * xfft[2 * k - 1] / m;
+    }
+
+    fftwDestroyPlan(&plan);
+    free(xfft);
+    free(power);
+
+    return WELCH_SUCCESS;
+}
+
+welchStatus_t dpss(int lenSignal, double halfBandwidth, int numTaper,
+                   double *tapers, double *lambda)
+{
+    double *d, *e;             /* Tridiagonal matrix of the DPSS */
+    double *dl, *dd, *du, *du2;  /* Factorization used in inverse iteration */
+    double *v;                 /* Current taper */
+    double w;                  /* Half-bandwidth in cycles per sample */
+    double bound;              /* Bound of all eigenvalues */
+    double lo, hi, theta;      /* Bisection interval and eigenvalue */
+    double norm, sign;
+    int n, k, i, it;
+    welchStatus_t status;
+
+    n = lenSignal;
+    w = halfBandwidth / n;
+
+    d = (double*) malloc(n * sizeof(double));
+    e = (double*) malloc(n * sizeof(double));
+    dl = (double*) malloc(n * sizeof(double));
+    dd = (double*) malloc(n * sizeof(double));
+    du = (double*) malloc(n * sizeof(double));
+    du2 = (double*) malloc(n * sizeof(double));
+    if (d == NULL || e == NULL || dl == NULL || dd == NULL || du == NULL
+        || du2 == NULL) {
+        fprintf(stderr, "Failed to allocate memory in dpss().\n");
+
+        free(d);
+        free(e);
+        free(dl);
+        free(dd);
+        free(du);
+        free(du2);
+
+        return WELCH_FAILURE;
+    }
+
+    /* The DPSS are the eigenvectors of this matrix with the largest
+     * eigenvalues */
+    e[0] = 0.0;
+    bound = 0.0;
+    for (i = 0; i < n; ++i) {
+        d[i] = (n - 1 - 2.0 * i) * (n - 1 - 2.0 * i) / 4 * cos(2 * PI * w);
+        if (i > 0) {
+            e[i] = i * (n - (double) i) / 2;
+        }
+    }
+    for (i = 0; i < n; ++i) {
+        norm = fabs(d[i]) + e[i] + (i + 1 < n ? e[i + 1] : 0.0);
+        if (norm > bound) {
+            bound = norm;
+        }
+    }
+
+    status = WELCH_SUCCESS;
+    for (k = 0; k < numTaper && status == WELCH_SUCCESS; ++k) {
+        /* Bisection for the (k + 1)-th largest eigenvalue */
+        lo = -bound;
+        hi = bound;
+        for (it = 0; it < DPSS_BISECTION && hi - lo > DBL_EPSILON * bound;
+             ++it) {
+            theta = (lo + hi) / 2;
+            if (sturmCount(d, e, n, theta) > n - 1 - k) {
+                hi = theta;
+            } else {
+                lo = theta;
+            }
+        }
+        theta = (lo + hi) / 2;
+
+        /* Inverse iteration, starting from a sine with k zero crossings */
+        v = tapers + (long) k * n;
+        for (i = 0; i < n; ++i) {
+            v[i] = sin(PI * (k + 1) * (i + 0.5) / n);
+        }
+
+        for (it = 0; it < DPSS_INVERSE_ITERATION; ++it) {
+            for (i = 0; i < n; ++i) {
+                dd[i] = d[i] - theta;
+                dl[i] = i + 1 < n ? e[i + 1] : 0.0;
+                du[i] = dl[i];
+            }
+            solveTridiagonal(dl, dd, du, du2, v, n, DBL_EPSILON * bound);
+
+            norm = 0.0;
+            for (i = 0; i < n; ++i) {
+                norm += v[i] * v[i];
+            }
+            norm = sqrt(norm);
+            for (i = 0; i < n; ++i) {
+                v[i] /= norm;
+            }
+        }
+
+        /* Symmetric tapers have a positive mean, antisymmetric tapers start
+         * with a positive lobe */
+        sign = 0.0;
+        for (i = 0; i < n; ++i) {
+            sign += (k % 2 == 0 ? 1.0 : n - 1 - 2.0 * i) * v[i];
+        }
+        if (sign < 0) {
+            for (i = 0; i < n; ++i) {
+                v[i] = -v[i];
+            }
+        }
+
+        if (lambda != NULL) {
+            status = concentration(v, n, w, &lambda[k]);
+        }
+    }
+
+    free(d);
+    free(e);
+    free(dl);
+    free(dd);
+    free(du);
+    free(du2);
+
+    return status;
+}
+
+/**
+ * Make sure the cache holds the tapers and plan for the given parameters
+ */
+static welchStatus_t prepareCache(int lenSignal, double halfBandwidth,
+                                  int numTaper, int nfft, int useOpenMP)
+{
+    double *tapers, *lambda;
+
+    if (cache.tapers == NULL || cache.lenSignal != lenSignal
+        || cache.halfBandwidth != halfBandwidth
+        || cache.numTaper != numTaper) {
+        tapers = (double*) malloc((long) numTaper * lenSignal
+                                  * sizeof(double));
+        lambda = (double*) malloc(numTaper * sizeof(double));
+        if (tapers == NULL || lambda == NULL) {
+            fprintf(stderr, "Failed to allocate memory in multitaper().\n");
+
+            free(tapers);
+            free(lambda);
+
+            return WELCH_FAILURE;
+        }
+
+        if (dpss(lenSignal, halfBandwidth, numTaper, tapers, lambda)
+            != WELCH_SUCCESS) {
+            free(tapers);
+            free(lambda);
+
+            return WELCH_FAILURE;
+        }
+
+        free(cache.tapers);
+        free(cache.lambda);
+        cache.tapers = tapers;
+        cache.lambda = lambda;
+        cache.lenSignal = lenSignal;
+        cache.halfBandwidth = halfBandwidth;
+        cache.numTaper = numTaper;
+    }
+
+    if (!cache.hasPlan || cache.nfft != nfft || cache.plan.howmany != numTaper
+        || cache.useOpenMP != useOpenMP) {
+        if (cache.hasPlan) {
+            fftwDestroyPlan(&cache.plan);
+            cache.hasPlan = 0;
+        }
+
+        if (fftwCreatePlan(&cache.plan, nfft, numTaper, useOpenMP)
+            != WELCH_SUCCESS) {
+            return WELCH_FAILURE;
+        }
+
+        cache.hasPlan = 1;
+        cache.nfft = nfft;
+        cache.useOpenMP = useOpenMP;
+    }
+
+    return WELCH_SUCCESS;
+}
+
+welchStatus_t multitaper(double *signal, double **Pxx, double **frequency,
+                         double samplingFrequency, int lenSignal,
+                         int *lenPxx, double halfBandwidth, int numTaper,
+                         int adaptive, char *fftType, int nfft)
+{
+    double *tapered;            /* Tapered copy in the input of the plan */
+    double *signalfft;          /* FFT of every tapered copy */
+    double *eigenspectra;       /* Power spectrum of every tapered copy */
+    double *PxxInternal;        /* Pxx is only touched on success */
+    double *frequencyInternal;  /* Similar purpose, but for frequency */
+    double mean, variance;      /* Statistics of the signal */
+    double S, previous;         /* Adaptive estimate at a frequency */
+    double dk, num, den;        /* Adaptive weights and their sums */
+    double *lambda;
+    int lenPxxInternal;
+    int useOpenMP;
+    int i, k, it;
+
+    /* Check inputs */
+    if (samplingFrequency <= 0) {
+        fprintf(stderr, "Sampling frequency of signal must be positive.\n");
+
+        return WELCH_FAILURE;
+    }
+
+    if (lenSignal <= 0 || nfft < lenSignal) {
+        fprintf(stderr, "Number of FFT points must be at least the length "
+                "of signal.\n");
+
+        return WELCH_FAILURE;
+    }
+
+    if (halfBandwidth <= 0 || halfBandwidth >= lenSignal / 2.0
+        || numTaper <= 0 || numTaper > lenSignal) {
+        fprintf(stderr, "Error in multitaper(): Invalid bandwidth or number "
+                "of tapers.\n");
+
+        return WELCH_FAILURE;
+    }
+
+    if (strcmp(fftType, "fftw") == 0) {
+        useOpenMP = 0;
+    } else if (strcmp(fftType, "fftw_openmp") == 0) {
+        useOpenMP = 1;
+    } else {
+        fprintf(stderr, "Error in multitaper(): Unrecoginzed FFT "
+                "implementation.\n");
+
+        return WELCH_FAILURE;
+    }
+
+    if (prepareCache(lenSignal, halfBandwidth, numTaper, nfft, useOpenMP)
+        != WELCH_SUCCESS) {
+        return WELCH_FAILURE;
+    }
+    lambda = cache.lambda;
+
+    lenPxxInternal = nfft % 2 == 0 ? nfft / 2 + 1 : (nfft + 1) / 2;
+
+    signalfft = (double*) malloc((long) numTaper * nfft * sizeof(double));
+    eigenspectra = (double*) calloc((long) numTaper * lenPxxInternal,
+                                    sizeof(double));
+    PxxInternal = (double*) malloc(lenPxxInternal * sizeof(double));
+    frequencyInternal = (double*) malloc(lenPxxInternal * sizeof(double));
+    if (signalfft == NULL || eigenspectra == NULL || PxxInternal == NULL
+        || frequencyInternal == NULL) {
+        fprintf(stderr, "Failed to allocate memory in multitaper().\n");
+
+        free(signalfft);
+        free(eigenspectra);
+        free(PxxInternal);
+        free(frequencyInternal);
+
+        return WELCH_FAILURE;
+    }
+
+    /* Taper straight into the input of the plan, and transform all copies
+     * at once */
+    for (k = 0; k < numTaper; ++k) {
+        tapered = cache.plan.in + (long) k * nfft;
+        for (i = 0; i < lenSignal; ++i) {
+            tapered[i] = signal[i] * cache.tapers[(long) k * lenSignal + i];
+        }
+        for (; i < nfft; ++i) {
+            tapered[i] = 0.0;
+        }
+    }
+
+    fftwExecuteInput(&cache.plan, signalfft);
+
+    for (k = 0; k < numTaper; ++k) {
+        addPeriodogram(signalfft + (long) k * nfft, nfft,
+                       eigenspectra + (long) k * lenPxxInternal);
+    }
+
+    /* Combine eigenspectra */
+    for (i = 0; i < lenPxxInternal; ++i) {
+        S = 0.0;
+        for (k = 0; k < numTaper; ++k) {
+            S += eigenspectra[(long) k * lenPxxInternal + i];
+        }
+        PxxInternal[i] = S / numTaper;
+    }
+
+    if (adaptive && numTaper > 1) {
+        mean = 0.0;
+        for (i = 0; i < lenSignal; ++i) {
+            mean += signal[i];
+        }
+        mean /= lenSignal;
+
+        variance = 0.0;
+        for (i = 0; i < lenSignal; ++i) {
+            variance += (signal[i] - mean) * (signal[i] - mean);
+        }
+        variance /= lenSignal;
+
+        /* Thomson's adaptive weights, starting from the first two tapers */
+        for (i = 0; i < lenPxxInternal; ++i) {
+            S = (eigenspectra[i] + eigenspectra[lenPxxInternal + i]) / 2;
+
+            for (it = 0; it < ADAPTIVE_ITERATION; ++it) {
+                num = 0.0;
+                den = 0.0;
+                for (k = 0; k < numTaper; ++k) {
+                    dk = sqrt(lambda[k]) * S
+                         / (lambda[k] * S + (1 - lambda[k]) * variance);
+                    num += dk * dk * eigenspectra[(long) k * lenPxxInternal
+                                                  + i];
+                    den += dk * dk;
+                }
+
+                previous = S;
+                S = den > 0 ? num / den : 0.0;
+                if (fabs(S - previous) <= ADAPTIVE_TOLERANCE * S) {
+                    break;
+                }
+            }
+
+            PxxInternal[i] = S;
+        }
+    }
+
+    /* Tapers have unit energy, so only the sampling frequency scales Pxx */
+    scalePeriodogram(PxxInternal, nfft, 1.0 / samplingFrequency);
+
+    for (i = 0; i < lenPxxInternal; ++i) {
+        frequencyInternal[i] = i * samplingFrequency / nfft;
+    }
+
+    free(signalfft);
+    free(eigenspectra);
+
+    *Pxx = PxxInternal;
+    *frequency = frequencyInternal;
+    *lenPxx = lenPxxInternal;
+
+    return WELCH_SUCCESS;
+}
+
+void multitaperCleanup(void)
+{
+    if (cache.hasPlan) {
+        fftwDestroyPlan(&cache.plan);
+    }
+
+    free(cache.tapers);
+    free(cache.lambda);
+    memset(&cache, 0, sizeof(cache));
+}
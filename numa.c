@@ -0,0 +1,235 @@
+/**
+ * File: numa.c
+ * Description: Implements the NUMA-aware execution mode of the Welch method.
+ *              Segments are split among OpenMP threads pinned to NUMA nodes,
+ *              every thread works on memory it touched first, and partial
+ *              spectral densities are reduced hierarchically.
+ *
+ * Author: Xiaojun Wu <xiaojun.wu@nyu.edu>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <numa.h>
+#include <omp.h>
+#include "welch.h"
+
+welchStatus_t welchNuma(double *signal, double *window, int lenSignal,
+                        int lenSegment, int lenOverlap, int nfft, double *Pxx)
+{
+    struct bitmask *allowed;  /* NUMA nodes this process may allocate on */
+    double **threadPxx;  /* Partial Pxx of every thread */
+    int *threadNode;     /* Index in nodes of the node of every thread */
+    int *nodes;          /* NUMA nodes in use, not necessarily contiguous */
+    int numNode;         /* Number of NUMA nodes in use */
+    int numThread;       /* Largest number of threads to use */
+    int numSegment;      /* Number of segments */
+    int lenHop;          /* Distance between two segments */
+    int lenPxx;          /* Length of Pxx */
+    int failed;          /* Set by a thread that has failed */
+    int i, t;
+
+    nodes = NULL;
+    numNode = 0;
+    if (numa_available() >= 0) {
+        /* Node IDs may have holes, and cpusets may exclude some nodes */
+        nodes = (int*) malloc((numa_max_node() + 1) * sizeof(int));
+        allowed = numa_get_mems_allowed();
+        for (i = 0; nodes != NULL && i <= numa_max_node(); ++i) {
+            if (numa_bitmask_isbitset(allowed, i)) {
+                nodes[numNode++] = i;
+            }
+        }
+        numa_bitmask_free(allowed);
+    }
+    if (numNode == 0) {
+        numNode = 1;
+    }
+
+    lenHop = lenSegment - lenOverlap;
+    numSegment = (lenSignal - lenOverlap) / lenHop;
+    lenPxx = nfft / 2 + 1;
+    if (nfft % 2 != 0) {
+        lenPxx = (nfft + 1) / 2;
+    }
+
+    numThread = omp_get_max_threads();
+    threadPxx = (double**) calloc(numThread, sizeof(double*));
+    threadNode = (int*) malloc(numThread * sizeof(int));
+    if (threadPxx == NULL || threadNode == NULL) {
+        fprintf(stderr, "Failed to allocate memory in welchNuma().\n");
+
+        free(threadPxx);
+        free(threadNode);
+        free(nodes);
+
+        return WELCH_FAILURE;
+    }
+
+    failed = 0;
+
+    #pragma omp parallel num_threads(numThread) private(i, t)
+    {
+        struct bitmask *savedCpus;  /* Affinity of the thread on entry */
+        fftwPlan_t plan;          /* FFT plan with node-local buffers */
+        double *localSignal;      /* Signal used by this thread */
+        double *windowedSignal;   /* Segment multiplied with window */
+        double *signalfft;        /* FFT of windowed segment */
+        double *localPxx;         /* Partial Pxx of this thread */
+        int tid;                  /* Thread index */
+        int numWorker;            /* Number of threads actually running */
+        int first, last;          /* Range of segments of this thread */
+        int start;                /* First sample of the segment range */
+        int lenLocal;             /* Number of samples used by this thread */
+        int hasPlan;              /* Whether plan was created */
+        int hasFailed;            /* Local copy of failed */
+        int j;
+
+        tid = omp_get_thread_num();
+        numWorker = omp_get_num_threads();
+
+        /* Threads are assigned to nodes in contiguous groups, so that
+         * neighboring ranges of the signal stay on the same node */
+        threadNode[tid] = tid * numNode / numWorker;
+        savedCpus = NULL;
+        if (numNode > 1) {
+            /* OpenMP threads outlive this call, so their affinity is
+             * restored before returning */
+            savedCpus = numa_allocate_cpumask();
+            if (numa_sched_getaffinity(0, savedCpus) < 0) {
+                numa_free_cpumask(savedCpus);
+                savedCpus = NULL;
+            } else {
+                numa_run_on_node(nodes[threadNode[tid]]);
+            }
+        }
+
+        first = tid * numSegment / numWorker;
+        last = (tid + 1) * numSegment / numWorker;
+        start = first * lenHop;
+        lenLocal = (last - first - 1) * lenHop + lenSegment;
+
+        localSignal = NULL;
+        windowedSignal = (double*) malloc(lenSegment * sizeof(double));
+        signalfft = (double*) malloc(nfft * sizeof(double));
+        localPxx = (double*) malloc(lenPxx * sizeof(double));
+        hasPlan = 0;
+
+        if (windowedSignal == NULL || signalfft == NULL || localPxx == NULL) {
+            #pragma omp atomic write
+            failed = 1;
+        } else {
+            /* Touch the buffers from the owning thread */
+            for (j = 0; j < lenPxx; ++j) {
+                localPxx[j] = 0.0;
+            }
+
+            /* The planner of fftw is not thread safe */
+            #pragma omp critical
+            hasPlan = fftwCreatePlan(&plan, nfft, 1, 0) == WELCH_SUCCESS;
+            if (!hasPlan) {
+                #pragma omp atomic write
+                failed = 1;
+            }
+        }
+
+        /* Copy this thread's part of the signal to node-local memory */
+        if (hasPlan && numNode > 1 && last > first) {
+            localSignal = (double*) malloc(lenLocal * sizeof(double));
+            if (localSignal == NULL) {
+                #pragma omp atomic write
+                failed = 1;
+            } else {
+                for (j = 0; j < lenLocal; ++j) {
+                    localSignal[j] = signal[start + j];
+                }
+            }
+        }
+
+        #pragma omp atomic read
+        hasFailed = failed;
+
+        if (hasPlan && !hasFailed) {
+            for (i = first; i < last; ++i) {
+                if (localSignal != NULL) {
+                    for (j = 0; j < lenSegment; ++j) {
+                        windowedSignal[j] = localSignal[(i - first) * lenHop
+                                                        + j] * window[j];
+                    }
+                } else {
+                    for (j = 0; j < lenSegment; ++j) {
+                        windowedSignal[j] = signal[i * lenHop + j]
+                                            * window[j];
+                    }
+                }
+
+                if (fftwExecute(&plan, windowedSignal, lenSegment, signalfft)
+                    != WELCH_SUCCESS) {
+                    #pragma omp atomic write
+                    failed = 1;
+                    break;
+                }
+
+                addPeriodogram(signalfft, nfft, localPxx);
+            }
+        }
+
+        threadPxx[tid] = localPxx;
+
+        #pragma omp barrier
+
+        /* Every thread has finished writing failed */
+        #pragma omp atomic read
+        hasFailed = failed;
+
+        /* Reduce within each node into the partial Pxx of its first thread */
+        if (!hasFailed && (tid == 0 || threadNode[tid - 1] != threadNode[tid])) {
+            for (t = tid + 1;
+                 t < numWorker && threadNode[t] == threadNode[tid]; ++t) {
+                for (j = 0; j < lenPxx; ++j) {
+                    localPxx[j] += threadPxx[t][j];
+                }
+            }
+        }
+
+        #pragma omp barrier
+
+        /* Reduce across nodes */
+        if (!hasFailed && tid == 0) {
+            for (t = 0; t < numWorker; ++t) {
+                if (t == 0 || threadNode[t - 1] != threadNode[t]) {
+                    for (j = 0; j < lenPxx; ++j) {
+                        Pxx[j] += threadPxx[t][j];
+                    }
+                }
+            }
+        }
+
+        #pragma omp barrier
+
+        if (hasPlan) {
+            #pragma omp critical
+            fftwDestroyPlan(&plan);
+        }
+        free(localSignal);
+        free(windowedSignal);
+        free(signalfft);
+        free(localPxx);
+
+        if (savedCpus != NULL) {
+            numa_sched_setaffinity(0, savedCpus);
+            numa_free_cpumask(savedCpus);
+        }
+    }
+
+    free(threadPxx);
+    free(threadNode);
+    free(nodes);
+
+    if (failed) {
+        fprintf(stderr, "Error in welchNuma(): Failed to compute segments.\n");
+
+        return WELCH_FAILURE;
+    }
+
+    return WELCH_SUCCESS;
+}
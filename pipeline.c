@@ -0,0 +1,446 @@
+/**
+ * File: pipeline.c
+ * Description: Implements the Welch method for signals stored in a file. A
+ *              reader stage and a compute stage run concurrently and exchange
+ *              pre-allocated blocks of samples through a lock-free bounded
+ *              queue, so reading the next block overlaps with computing the
+ *              segments of the current one. The reader runs on its own
+ *              thread and the compute stage on the calling thread, so the
+ *              two always run concurrently, whatever OpenMP grants.
+ *
+ * Author: Xiaojun Wu <xiaojun.wu@nyu.edu>
+ */
+#define _XOPEN_SOURCE 700
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <omp.h>
+#include "welch.h"
+
+#define PIPELINE_NUM_BLOCKS 4     /* Number of blocks shared by the two stages */
+#define PIPELINE_SPIN 1024        /* Polls before a waiting stage yields */
+#define PIPELINE_YIELD 64         /* Yields before a waiting stage sleeps */
+#define PIPELINE_MAX_SLEEP 100000 /* Longest sleep of a waiting stage in ns */
+
+/**
+ * A block of samples. Besides lenBlock new samples, a block starts with a halo
+ * of the last samples of the previous block so that segments spanning the
+ * boundary of two blocks can be computed from a single block.
+ */
+typedef struct {
+    double *samples;  /* Halo followed by new samples */
+    long index;       /* Index of the block in the signal */
+    int lenNew;       /* Number of new samples in this block */
+} pipelineBlock_t;
+
+/**
+ * Single-producer single-consumer queue of blocks. Block i of the signal is
+ * stored in slot i % PIPELINE_NUM_BLOCKS.
+ */
+typedef struct {
+    pipelineBlock_t blocks[PIPELINE_NUM_BLOCKS];
+    atomic_long produced;  /* Number of blocks filled by the reader */
+    atomic_long consumed;  /* Number of blocks released by compute stage */
+    atomic_int failed;     /* Set by a stage that has failed */
+} pipelineQueue_t;
+
+/**
+ * Arguments of the reader thread
+ */
+typedef struct {
+    pipelineQueue_t *queue;
+    welchPipelineStats_t *stats;
+    long lenSignal;
+    int fd;
+    int lenBlock;
+    int lenHalo;
+} pipelineReader_t;
+
+static double elapsed(double tic)
+{
+    return omp_get_wtime() - tic;
+}
+
+/**
+ * One step of waiting for the other stage. The first polls only spin, so a
+ * short wait costs no system call; then the stage yields its CPU, and finally
+ * sleeps for exponentially longer times. Without this, a stage that shares a
+ * CPU with the other one burns its time slices while the other cannot run.
+ * round - number of steps already taken in this wait
+ */
+static void backoff(long round)
+{
+    struct timespec pause;
+    long shift;
+
+    if (round < PIPELINE_SPIN) {
+        return;
+    }
+
+    if (round < PIPELINE_SPIN + PIPELINE_YIELD) {
+        sched_yield();
+
+        return;
+    }
+
+    shift = round - PIPELINE_SPIN - PIPELINE_YIELD;
+    pause.tv_sec = 0;
+    pause.tv_nsec = shift < 17 ? 1000L << shift : PIPELINE_MAX_SLEEP;
+    if (pause.tv_nsec > PIPELINE_MAX_SLEEP) {
+        pause.tv_nsec = PIPELINE_MAX_SLEEP;
+    }
+    nanosleep(&pause, NULL);
+}
+
+/**
+ * Reader stage. Fills the blocks of the queue in order with pread(), and
+ * advises the kernel to read ahead the block after the current one.
+ */
+static void readerStage(pipelineQueue_t *queue, int fd, long lenSignal,
+                        int lenBlock, int lenHalo,
+                        welchPipelineStats_t *stats)
+{
+    pipelineBlock_t *block;     /* Block being filled */
+    pipelineBlock_t *previous;  /* Block that provides the halo */
+    long numBlock;              /* Number of blocks in the signal */
+    long k;                     /* Index of the current block */
+    long offset;                /* First new sample of the current block */
+    size_t size;                /* Bytes to read */
+    size_t done;                /* Bytes already read */
+    ssize_t got;                /* Bytes read by one call of pread() */
+    long round;                 /* Steps of the current wait */
+    double tic;
+
+    numBlock = (lenSignal + lenBlock - 1) / lenBlock;
+
+    for (k = 0; k < numBlock; ++k) {
+        /* Wait for the compute stage to release the slot */
+        if (k - atomic_load_explicit(&queue->consumed, memory_order_acquire)
+            >= PIPELINE_NUM_BLOCKS) {
+            ++stats->readerStalls;
+            tic = omp_get_wtime();
+            for (round = 0; k - atomic_load_explicit(&queue->consumed,
+                                                     memory_order_acquire)
+                            >= PIPELINE_NUM_BLOCKS; ++round) {
+                if (atomic_load(&queue->failed)) {
+                    return;
+                }
+                backoff(round);
+            }
+            stats->readerStallTime += elapsed(tic);
+        }
+
+        block = &queue->blocks[k % PIPELINE_NUM_BLOCKS];
+        offset = k * lenBlock;
+        block->index = k;
+        block->lenNew = lenSignal - offset < lenBlock ? lenSignal - offset
+                                                      : lenBlock;
+
+        /* The compute stage only reads the previous block, so its tail can
+         * be copied at the same time */
+        if (k > 0) {
+            previous = &queue->blocks[(k - 1) % PIPELINE_NUM_BLOCKS];
+            memcpy(block->samples, previous->samples + lenBlock,
+                   lenHalo * sizeof(double));
+        }
+
+        tic = omp_get_wtime();
+        if (k + 1 < numBlock) {
+            posix_fadvise(fd, (offset + lenBlock) * sizeof(double),
+                          lenBlock * sizeof(double), POSIX_FADV_WILLNEED);
+        }
+
+        size = block->lenNew * sizeof(double);
+        for (done = 0; done < size; done += got) {
+            got = pread(fd, (char*) (block->samples + lenHalo) + done,
+                        size - done, offset * sizeof(double) + done);
+            if (got <= 0) {
+                fprintf(stderr, "Error in welchFile(): Failed to read the "
+                        "signal.\n");
+
+                atomic_store(&queue->failed, 1);
+
+                return;
+            }
+        }
+        stats->readTime += elapsed(tic);
+
+        atomic_store_explicit(&queue->produced, k + 1, memory_order_release);
+    }
+}
+
+static void *readerThread(void *arg)
+{
+    pipelineReader_t *reader = (pipelineReader_t*) arg;
+
+    readerStage(reader->queue, reader->fd, reader->lenSignal,
+                reader->lenBlock, reader->lenHalo, reader->stats);
+
+    return NULL;
+}
+
+/**
+ * Compute stage. Processes, in block k, the segments starting in
+ * [k * lenBlock - lenHalo, (k + 1) * lenBlock - lenHalo), which are exactly
+ * the segments contained in the halo and new samples of the block.
+ */
+static void computeStage(pipelineQueue_t *queue, fftwPlan_t *plan,
+                         double *window, double *windowedSignal,
+                         double *signalfft, double *PxxInternal,
+                         long lenSignal, int lenSegment, int lenHop,
+                         int lenBlock, int lenHalo,
+                         welchPipelineStats_t *stats)
+{
+    pipelineBlock_t *block;  /* Block being processed */
+    long numBlock;           /* Number of blocks in the signal */
+    long k;                  /* Index of the current block */
+    long first;              /* Sample stored at the start of the block */
+    long start;              /* First sample of the current segment */
+    double *segment;         /* Current segment */
+    long round;              /* Steps of the current wait */
+    int j;
+    double tic;
+
+    numBlock = (lenSignal + lenBlock - 1) / lenBlock;
+
+    for (k = 0; k < numBlock; ++k) {
+        /* Wait for the reader to fill the slot */
+        if (atomic_load_explicit(&queue->produced, memory_order_acquire)
+            <= k) {
+            ++stats->computeStalls;
+            tic = omp_get_wtime();
+            for (round = 0; atomic_load_explicit(&queue->produced,
+                                                 memory_order_acquire) <= k;
+                 ++round) {
+                if (atomic_load(&queue->failed)) {
+                    return;
+                }
+                backoff(round);
+            }
+            stats->computeStallTime += elapsed(tic);
+        }
+
+        tic = omp_get_wtime();
+        block = &queue->blocks[k % PIPELINE_NUM_BLOCKS];
+        first = k * lenBlock - lenHalo;
+
+        for (start = first; start < first + lenBlock; start += lenHop) {
+            if (start < 0) {
+                continue;
+            }
+            if (start + lenSegment > lenSignal) {
+                break;
+            }
+
+            segment = block->samples + (start - first);
+            for (j = 0; j < lenSegment; ++j) {
+                windowedSignal[j] = segment[j] * window[j];
+            }
+
+            if (fftwExecute(plan, windowedSignal, lenSegment, signalfft)
+                != WELCH_SUCCESS) {
+                atomic_store(&queue->failed, 1);
+
+                return;
+            }
+
+            addPeriodogram(signalfft, plan->nfft, PxxInternal);
+        }
+        stats->computeTime += elapsed(tic);
+
+        atomic_store_explicit(&queue->consumed, k + 1, memory_order_release);
+    }
+}
+
+welchStatus_t welchFile(char *path, double **Pxx, double **frequency,
+                        double samplingFrequency, int lenSegment,
+                        int lenOverlap, int *lenPxx, char *windowType,
+                        char *fftType, int nfft, int lenBlock,
+                        welchPipelineStats_t *stats)
+{
+    pipelineQueue_t queue;      /* Blocks shared by the two stages */
+    pipelineReader_t reader;    /* Arguments of the reader thread */
+    pthread_t readerId;         /* Thread running the reader stage */
+    welchPipelineStats_t statsInternal;
+    fftwPlan_t plan;            /* FFT plan of the compute stage */
+    double *PxxInternal;        /* Pxx is only touched on success */
+    double *frequencyInternal;  /* Similar purpose, but for frequency */
+    double *window;             /* Array representing the window function */
+    double *windowedSignal;     /* Segment multiplied with window */
+    double *signalfft;          /* FFT of windowed segment */
+    double normSquared;         /* Squared norm of window */
+    struct stat fileStat;       /* Used to get the length of the signal */
+    long lenSignal;             /* Number of samples in the file */
+    int lenHop;                 /* Distance between two segments */
+    int lenHalo;                /* Samples carried over between blocks */
+    int lenPxxInternal;
+    int useOpenMP;
+    int fd;
+    int i;
+    welchStatus_t status;
+    double tic;
+
+    /* Check inputs */
+    if (strcmp(fftType, "fftw") == 0) {
+        useOpenMP = 0;
+    } else if (strcmp(fftType, "fftw_openmp") == 0) {
+        useOpenMP = 1;
+    } else {
+        fprintf(stderr, "Error in welchFile(): Unrecoginzed FFT "
+                "implementation.\n");
+
+        return WELCH_FAILURE;
+    }
+
+    if (samplingFrequency <= 0 || lenSegment <= 0 || lenOverlap < 0
+        || lenOverlap >= lenSegment || nfft < lenSegment || lenBlock <= 0) {
+        fprintf(stderr, "Error in welchFile(): Invalid parameters.\n");
+
+        return WELCH_FAILURE;
+    }
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error in welchFile(): Failed to open %s.\n", path);
+
+        return WELCH_FAILURE;
+    }
+
+    if (fstat(fd, &fileStat) != 0) {
+        fprintf(stderr, "Error in welchFile(): Failed to get size of %s.\n",
+                path);
+
+        close(fd);
+
+        return WELCH_FAILURE;
+    }
+
+    lenSignal = fileStat.st_size / sizeof(double);
+    lenHop = lenSegment - lenOverlap;
+    if (lenSignal < lenSegment || (lenSignal - lenOverlap) % lenHop != 0) {
+        fprintf(stderr, "Unable to determine integral number of segments.\n");
+
+        close(fd);
+
+        return WELCH_FAILURE;
+    }
+
+    /* Blocks hold a whole number of hops, and the halo is the shortest run of
+     * whole hops covering the part of a segment that precedes its block */
+    lenBlock = (lenBlock + lenHop - 1) / lenHop * lenHop;
+    lenHalo = (lenSegment + lenHop - 1) / lenHop * lenHop - lenHop;
+    lenPxxInternal = nfft / 2 + 1;
+    if (nfft % 2 != 0) {
+        lenPxxInternal = (nfft + 1) / 2;
+    }
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    /* Allocate everything before the stages start */
+    atomic_init(&queue.produced, 0);
+    atomic_init(&queue.consumed, 0);
+    atomic_init(&queue.failed, 0);
+    memset(&statsInternal, 0, sizeof(statsInternal));
+    window = (double*) malloc(lenSegment * sizeof(double));
+    windowedSignal = (double*) malloc(lenSegment * sizeof(double));
+    signalfft = (double*) malloc(nfft * sizeof(double));
+    PxxInternal = (double*) calloc(lenPxxInternal, sizeof(double));
+    frequencyInternal = (double*) malloc(lenPxxInternal * sizeof(double));
+    status = WELCH_SUCCESS;
+    for (i = 0; i < PIPELINE_NUM_BLOCKS; ++i) {
+        queue.blocks[i].samples = (double*) malloc((lenHalo + lenBlock)
+                                                   * sizeof(double));
+        if (queue.blocks[i].samples == NULL) {
+            status = WELCH_FAILURE;
+        }
+    }
+
+    if (status != WELCH_SUCCESS || window == NULL || windowedSignal == NULL
+        || signalfft == NULL || PxxInternal == NULL
+        || frequencyInternal == NULL) {
+        fprintf(stderr, "Failed to allocate memory in welchFile().\n");
+
+        status = WELCH_FAILURE;
+    } else {
+        status = getWindow(windowType, window, lenSegment);
+    }
+
+    if (status == WELCH_SUCCESS) {
+        status = fftwCreatePlan(&plan, nfft, 1, useOpenMP);
+    }
+
+    if (status == WELCH_SUCCESS) {
+        tic = omp_get_wtime();
+
+        /* The stages wait for each other, so the reader must not depend on
+         * OpenMP granting a second thread. The compute stage stays on the
+         * calling thread, outside any parallel region of this function, so
+         * that "fftw_openmp" can use every OpenMP thread. */
+        reader.queue = &queue;
+        reader.stats = &statsInternal;
+        reader.lenSignal = lenSignal;
+        reader.fd = fd;
+        reader.lenBlock = lenBlock;
+        reader.lenHalo = lenHalo;
+        if (pthread_create(&readerId, NULL, readerThread, &reader) != 0) {
+            fprintf(stderr, "Error in welchFile(): Failed to start the "
+                    "reader thread.\n");
+
+            atomic_store(&queue.failed, 1);
+        } else {
+            computeStage(&queue, &plan, window, windowedSignal, signalfft,
+                         PxxInternal, lenSignal, lenSegment, lenHop, lenBlock,
+                         lenHalo, &statsInternal);
+            pthread_join(readerId, NULL);
+        }
+
+        statsInternal.totalTime = elapsed(tic);
+        fftwDestroyPlan(&plan);
+
+        if (atomic_load(&queue.failed)) {
+            status = WELCH_FAILURE;
+        }
+    }
+
+    if (status == WELCH_SUCCESS) {
+        normSquared = 0.0;
+        for (i = 0; i < lenSegment; ++i) {
+            normSquared += window[i] * window[i];
+        }
+
+        scalePeriodogram(PxxInternal, nfft,
+                         1.0 / (samplingFrequency * normSquared
+                                * ((lenSignal - lenOverlap) / lenHop)));
+
+        for (i = 0; i < lenPxxInternal; ++i) {
+            frequencyInternal[i] = i * samplingFrequency / nfft;
+        }
+
+        *Pxx = PxxInternal;
+        *frequency = frequencyInternal;
+        *lenPxx = lenPxxInternal;
+        if (stats != NULL) {
+            *stats = statsInternal;
+        }
+    } else {
+        free(PxxInternal);
+        free(frequencyInternal);
+    }
+
+    for (i = 0; i < PIPELINE_NUM_BLOCKS; ++i) {
+        free(queue.blocks[i].samples);
+    }
+    free(window);
+    free(windowedSignal);
+    free(signalfft);
+    close(fd);
+
+    return status;
+}
@@ -0,0 +1,486 @@
+/**
+ * File: realtime.c
+ * Description: Implements a real-time mode of the Welch method. An acquisition
+ *              thread pushes blocks of samples into a lock-free single-producer
+ *              single-consumer ring, and a dedicated consumer thread updates
+ *              the spectral density estimate. Nothing on the path from a push
+ *              to the update of Pxx allocates memory, takes a lock or makes a
+ *              system call, except the wake-up of an idle consumer that is
+ *              allowed to sleep. The latency of every update is recorded in a
+ *              histogram with logarithmic buckets that can be queried at any
+ *              time.
+ *
+ * Author: Xiaojun Wu <xiaojun.wu@nyu.edu>
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include "welch.h"
+
+#define RT_SUB_BUCKET_BITS 4  /* 16 buckets per power of 2, 6% resolution */
+#define RT_SUB_BUCKETS (1 << RT_SUB_BUCKET_BITS)
+#define RT_NUM_BUCKETS ((64 - RT_SUB_BUCKET_BITS) * RT_SUB_BUCKETS)
+#define RT_SPIN 4096          /* Empty polls before the consumer sleeps */
+
+/**
+ * A slot of the ring, holding one hop of samples
+ */
+typedef struct {
+    double *samples;       /* lenSegment - lenOverlap samples */
+    long arrival;          /* Time of the push in nanoseconds */
+    int afterDrop;         /* Blocks were dropped right before this one */
+} rtSlot_t;
+
+struct welchRealtime_s {
+    /* Ring shared by producer and consumer */
+    rtSlot_t *slots;
+    int numSlot;               /* Capacity of the ring, a power of 2 */
+    atomic_long head;          /* Number of blocks pushed */
+    atomic_long tail;          /* Number of blocks consumed */
+    int pendingDrop;           /* Producer dropped a block since last push */
+
+    /* Consumer state */
+    pthread_t consumer;
+    atomic_int running;
+    fftwPlan_t plan;
+    double *window;
+    double *history;           /* Samples from the start of the next segment */
+    double *windowedSignal;
+    double *signalfft;
+    int filled;                /* Valid samples in history */
+
+    /* Pxx published with a sequence lock */
+    atomic_uint sequence;      /* Odd while the consumer updates PxxSum */
+    double *PxxSum;            /* Sum of periodograms */
+    long numSegment;           /* Number of periodograms in PxxSum */
+
+    /* Statistics */
+    atomic_long histogram[RT_NUM_BUCKETS];
+    atomic_long maxLatency;
+    atomic_long overruns;
+    atomic_long dropped;
+
+    /* Parameters */
+    double samplingFrequency;
+    double normSquared;
+    long deadline;             /* Deadline in nanoseconds */
+    long idle;                 /* Sleep of an idle consumer in nanoseconds */
+    int lenSegment;
+    int lenHop;
+    int lenPxx;
+    int nfft;
+};
+
+static long nowNs(void)
+{
+    struct timespec t;
+
+    /* Served by the vDSO on Linux, so no system call is made */
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+/**
+ * Histogram bucket of a latency. Values below 2 * RT_SUB_BUCKETS have their
+ * own bucket, larger ones share a bucket with values having the same leading
+ * RT_SUB_BUCKET_BITS + 1 bits.
+ */
+static int bucketOf(long value)
+{
+    int shift;
+
+    if (value < 2 * RT_SUB_BUCKETS) {
+        return value < 0 ? 0 : (int) value;
+    }
+
+    shift = 63 - __builtin_clzl((unsigned long) value) - RT_SUB_BUCKET_BITS;
+
+    return (shift + 1) * RT_SUB_BUCKETS
+           + (int) (value >> shift) - RT_SUB_BUCKETS;
+}
+
+/**
+ * Lowest value falling in a bucket
+ */
+static long valueOf(int bucket)
+{
+    int shift;
+
+    if (bucket < 2 * RT_SUB_BUCKETS) {
+        return bucket;
+    }
+
+    shift = bucket / RT_SUB_BUCKETS - 1;
+
+    return (long) (bucket % RT_SUB_BUCKETS + RT_SUB_BUCKETS) << shift;
+}
+
+/**
+ * Compute the periodogram of the segment at the start of history and
+ * publish it
+ */
+static void updatePxx(welchRealtime_t *rt, long arrival)
+{
+    long latency;
+    int j;
+
+    for (j = 0; j < rt->lenSegment; ++j) {
+        rt->windowedSignal[j] = rt->history[j] * rt->window[j];
+    }
+
+    if (fftwExecute(&rt->plan, rt->windowedSignal, rt->lenSegment,
+                    rt->signalfft) != WELCH_SUCCESS) {
+        return;
+    }
+
+    atomic_fetch_add_explicit(&rt->sequence, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    addPeriodogram(rt->signalfft, rt->nfft, rt->PxxSum);
+    ++rt->numSegment;
+    atomic_fetch_add_explicit(&rt->sequence, 1, memory_order_release);
+
+    /* The maximum is published before the count, so a reader that sees the
+     * count also sees a maximum at least as large */
+    latency = nowNs() - arrival;
+    if (latency > atomic_load_explicit(&rt->maxLatency,
+                                       memory_order_relaxed)) {
+        atomic_store_explicit(&rt->maxLatency, latency, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&rt->histogram[bucketOf(latency)], 1,
+                              memory_order_release);
+    if (latency > rt->deadline) {
+        atomic_fetch_add_explicit(&rt->overruns, 1, memory_order_relaxed);
+    }
+}
+
+static void *consumerThread(void *arg)
+{
+    welchRealtime_t *rt = (welchRealtime_t*) arg;
+    rtSlot_t *slot;
+    struct timespec idle;
+    long tail;
+    int spin;
+
+    idle.tv_sec = rt->idle / 1000000000L;
+    idle.tv_nsec = rt->idle % 1000000000L;
+    tail = atomic_load_explicit(&rt->tail, memory_order_relaxed);
+    spin = 0;
+
+    while (atomic_load_explicit(&rt->running, memory_order_relaxed)) {
+        if (atomic_load_explicit(&rt->head, memory_order_acquire) == tail) {
+            /* A block pushed during the sleep waits for its end */
+            if (rt->idle > 0 && ++spin >= RT_SPIN) {
+                nanosleep(&idle, NULL);
+                spin = 0;
+            }
+            continue;
+        }
+        spin = 0;
+
+        slot = &rt->slots[tail & (rt->numSlot - 1)];
+
+        /* A segment must not span a gap left by dropped blocks */
+        if (slot->afterDrop) {
+            rt->filled = 0;
+        }
+
+        /* History always starts at a multiple of the hop, so segments lie
+         * on the same grid as in welch() even when lenSegment is not a
+         * multiple of the hop. A block adds one hop and completes at most
+         * one segment, after which the hop is shifted out. */
+        memcpy(rt->history + rt->filled, slot->samples,
+               rt->lenHop * sizeof(double));
+        rt->filled += rt->lenHop;
+
+        if (rt->filled >= rt->lenSegment) {
+            updatePxx(rt, slot->arrival);
+            rt->filled -= rt->lenHop;
+            memmove(rt->history, rt->history + rt->lenHop,
+                    rt->filled * sizeof(double));
+        }
+
+        ++tail;
+        atomic_store_explicit(&rt->tail, tail, memory_order_release);
+    }
+
+    return NULL;
+}
+
+welchStatus_t welchRealtimeCreate(welchRealtime_t **rt,
+                                  double samplingFrequency, int lenSegment,
+                                  int lenOverlap, char *windowType, int nfft,
+                                  int numBlock, double deadline, double idle)
+{
+    welchRealtime_t *r;
+    int i;
+
+    if (samplingFrequency <= 0 || lenSegment <= 0 || lenOverlap < 0
+        || lenOverlap >= lenSegment || nfft < lenSegment || numBlock <= 0
+        || deadline <= 0 || idle < 0) {
+        fprintf(stderr, "Error in welchRealtimeCreate(): Invalid "
+                "parameters.\n");
+
+        return WELCH_FAILURE;
+    }
+
+    r = (welchRealtime_t*) calloc(1, sizeof(welchRealtime_t));
+    if (r == NULL) {
+        fprintf(stderr, "Failed to allocate memory in "
+                "welchRealtimeCreate().\n");
+
+        return WELCH_FAILURE;
+    }
+
+    r->samplingFrequency = samplingFrequency;
+    r->deadline = (long) (deadline * 1e9);
+    r->idle = (long) (idle * 1e9);
+    r->lenSegment = lenSegment;
+    r->lenHop = lenSegment - lenOverlap;
+    r->nfft = nfft;
+    r->lenPxx = nfft % 2 == 0 ? nfft / 2 + 1 : (nfft + 1) / 2;
+
+    /* Round the capacity up to a power of 2 so that indices wrap with a
+     * mask */
+    for (r->numSlot = 1; r->numSlot < numBlock; r->numSlot *= 2) {
+    }
+
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    atomic_init(&r->running, 1);
+    atomic_init(&r->sequence, 0);
+    atomic_init(&r->maxLatency, 0);
+    atomic_init(&r->overruns, 0);
+    atomic_init(&r->dropped, 0);
+    for (i = 0; i < RT_NUM_BUCKETS; ++i) {
+        atomic_init(&r->histogram[i], 0);
+    }
+
+    /* Everything the two threads use is allocated here */
+    r->slots = (rtSlot_t*) calloc(r->numSlot, sizeof(rtSlot_t));
+    r->window = (double*) malloc(lenSegment * sizeof(double));
+    r->history = (double*) malloc((lenSegment + r->lenHop)
+                                  * sizeof(double));
+    r->windowedSignal = (double*) malloc(lenSegment * sizeof(double));
+    r->signalfft = (double*) malloc(nfft * sizeof(double));
+    r->PxxSum = (double*) calloc(r->lenPxx, sizeof(double));
+    if (r->slots == NULL || r->window == NULL || r->history == NULL
+        || r->windowedSignal == NULL || r->signalfft == NULL
+        || r->PxxSum == NULL) {
+        fprintf(stderr, "Failed to allocate memory in "
+                "welchRealtimeCreate().\n");
+
+        welchRealtimeDestroy(r);
+
+        return WELCH_FAILURE;
+    }
+
+    for (i = 0; i < r->numSlot; ++i) {
+        r->slots[i].samples = (double*) malloc(r->lenHop * sizeof(double));
+        if (r->slots[i].samples == NULL) {
+            fprintf(stderr, "Failed to allocate memory in "
+                    "welchRealtimeCreate().\n");
+
+            welchRealtimeDestroy(r);
+
+            return WELCH_FAILURE;
+        }
+    }
+
+    if (getWindow(windowType, r->window, lenSegment) != WELCH_SUCCESS) {
+        welchRealtimeDestroy(r);
+
+        return WELCH_FAILURE;
+    }
+
+    r->normSquared = 0.0;
+    for (i = 0; i < lenSegment; ++i) {
+        r->normSquared += r->window[i] * r->window[i];
+    }
+
+    if (fftwCreatePlan(&r->plan, nfft, 1, 0) != WELCH_SUCCESS) {
+        welchRealtimeDestroy(r);
+
+        return WELCH_FAILURE;
+    }
+
+    if (pthread_create(&r->consumer, NULL, consumerThread, r) != 0) {
+        fprintf(stderr, "Error in welchRealtimeCreate(): Failed to start "
+                "the consumer thread.\n");
+
+        fftwDestroyPlan(&r->plan);
+        r->plan.plan = NULL;
+        welchRealtimeDestroy(r);
+
+        return WELCH_FAILURE;
+    }
+
+    *rt = r;
+
+    return WELCH_SUCCESS;
+}
+
+welchStatus_t welchRealtimePush(welchRealtime_t *rt, double *block)
+{
+    rtSlot_t *slot;
+    long head;
+
+    head = atomic_load_explicit(&rt->head, memory_order_relaxed);
+
+    /* Drop the block if the consumer is too far behind */
+    if (head - atomic_load_explicit(&rt->tail, memory_order_acquire)
+        >= rt->numSlot) {
+        atomic_fetch_add_explicit(&rt->dropped, 1, memory_order_relaxed);
+        rt->pendingDrop = 1;
+
+        return WELCH_FAILURE;
+    }
+
+    slot = &rt->slots[head & (rt->numSlot - 1)];
+    memcpy(slot->samples, block, rt->lenHop * sizeof(double));
+    slot->afterDrop = rt->pendingDrop;
+    slot->arrival = nowNs();
+    rt->pendingDrop = 0;
+
+    atomic_store_explicit(&rt->head, head + 1, memory_order_release);
+
+    return WELCH_SUCCESS;
+}
+
+welchStatus_t welchRealtimeGetPxx(welchRealtime_t *rt, double *Pxx,
+                                  double *frequency, long *numSegment)
+{
+    unsigned int before, after;
+    long count;
+    int i;
+
+    /* Retry until a copy is not torn by an update of the consumer */
+    do {
+        before = atomic_load_explicit(&rt->sequence, memory_order_acquire);
+        if (before % 2 != 0) {
+            continue;
+        }
+        for (i = 0; i < rt->lenPxx; ++i) {
+            Pxx[i] = rt->PxxSum[i];
+        }
+        count = rt->numSegment;
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&rt->sequence, memory_order_relaxed);
+    } while (before % 2 != 0 || before != after);
+
+    if (count == 0) {
+        return WELCH_FAILURE;
+    }
+
+    scalePeriodogram(Pxx, rt->nfft,
+                     1.0 / (rt->samplingFrequency * rt->normSquared * count));
+
+    if (frequency != NULL) {
+        for (i = 0; i < rt->lenPxx; ++i) {
+            frequency[i] = i * rt->samplingFrequency / rt->nfft;
+        }
+    }
+
+    if (numSegment != NULL) {
+        *numSegment = count;
+    }
+
+    return WELCH_SUCCESS;
+}
+
+int welchRealtimeLenPxx(welchRealtime_t *rt)
+{
+    return rt->lenPxx;
+}
+
+double welchRealtimeLatency(welchRealtime_t *rt, double percentile)
+{
+    long counts[RT_NUM_BUCKETS];
+    long total, target, sum, highest, maxLatency;
+    int i;
+
+    total = 0;
+    for (i = 0; i < RT_NUM_BUCKETS; ++i) {
+        counts[i] = atomic_load_explicit(&rt->histogram[i],
+                                         memory_order_acquire);
+        total += counts[i];
+    }
+
+    if (total == 0) {
+        return 0.0;
+    }
+
+    if (percentile >= 100) {
+        return atomic_load_explicit(&rt->maxLatency,
+                                    memory_order_relaxed) / 1e9;
+    }
+
+    target = (long) (percentile / 100 * total);
+    if (target < 1) {
+        target = 1;
+    }
+
+    sum = 0;
+    for (i = 0; i < RT_NUM_BUCKETS; ++i) {
+        sum += counts[i];
+        if (sum >= target) {
+            break;
+        }
+    }
+
+    /* Report the highest value of the bucket, so that the percentile is
+     * never under-reported, but not more than the exact maximum */
+    maxLatency = atomic_load_explicit(&rt->maxLatency, memory_order_relaxed);
+    highest = i + 1 < RT_NUM_BUCKETS ? valueOf(i + 1) - 1 : maxLatency;
+    if (highest > maxLatency) {
+        highest = maxLatency;
+    }
+
+    return highest / 1e9;
+}
+
+void welchRealtimeCounters(welchRealtime_t *rt, long *numUpdate,
+                           long *overruns, long *dropped)
+{
+    long total;
+    int i;
+
+    total = 0;
+    for (i = 0; i < RT_NUM_BUCKETS; ++i) {
+        total += atomic_load_explicit(&rt->histogram[i],
+                                      memory_order_relaxed);
+    }
+
+    *numUpdate = total;
+    *overruns = atomic_load_explicit(&rt->overruns, memory_order_relaxed);
+    *dropped = atomic_load_explicit(&rt->dropped, memory_order_relaxed);
+}
+
+void welchRealtimeDestroy(welchRealtime_t *rt)
+{
+    int i;
+
+    if (rt->plan.plan != NULL) {
+        atomic_store(&rt->running, 0);
+        pthread_join(rt->consumer, NULL);
+        fftwDestroyPlan(&rt->plan);
+    }
+
+    if (rt->slots != NULL) {
+        for (i = 0; i < rt->numSlot; ++i) {
+            free(rt->slots[i].samples);
+        }
+    }
+
+    free(rt->slots);
+    free(rt->window);
+    free(rt->history);
+    free(rt->windowedSignal);
+    free(rt->signalfft);
+    free(rt->PxxSum);
+    free(rt);
+}
@@ -0,0 +1,251 @@
+/**
+ * File: tune.c
+ * Description: Auto-tuning of the Welch method. Candidate FFT implementations,
+ *              thread counts and zero-padded FFT lengths are benchmarked for
+ *              a given shape of parameters, and the fastest configuration is
+ *              stored in a profile file that welch() reads when fftType is
+ *              "auto".
+ *
+ * Author: Xiaojun Wu <xiaojun.wu@nyu.edu>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "welch.h"
+
+#define TUNE_REPEAT 3           /* Runs of each candidate, the best is kept */
+#define PROFILE_LINE 256        /* Longest line of a profile file */
+#define NUM_FFT_TYPES 4
+
+static char *fftTypes[NUM_FFT_TYPES] = {"fftw", "fftw_openmp", "fftw_numa",
+                                        "cufft"};
+
+int fastFftSize(int n)
+{
+    int m, r;
+
+    for (m = n > 1 ? n : 1; ; ++m) {
+        r = m;
+        while (r % 2 == 0) {
+            r /= 2;
+        }
+        while (r % 3 == 0) {
+            r /= 3;
+        }
+        while (r % 5 == 0) {
+            r /= 5;
+        }
+        if (r == 1) {
+            return m;
+        }
+    }
+}
+
+char *welchProfilePath(void)
+{
+    char *path;
+
+    path = getenv("WELCH_PROFILE");
+
+    return path != NULL ? path : WELCH_PROFILE_DEFAULT;
+}
+
+welchStatus_t welchLookupProfile(char *profilePath, int lenSignal,
+                                 int lenSegment, int lenOverlap,
+                                 char *windowType, int nfft,
+                                 welchProfile_t *profile)
+{
+    FILE *file;
+    char line[PROFILE_LINE];
+    char window[PROFILE_LINE];
+    welchProfile_t entry;
+    int key[4];
+
+    file = fopen(profilePath, "r");
+    if (file == NULL) {
+        return WELCH_FAILURE;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (sscanf(line, "%d %d %d %d %255s %15s %d %d", &key[0], &key[1],
+                   &key[2], &key[3], window, entry.fftType,
+                   &entry.numThreads, &entry.nfft) != 8) {
+            continue;
+        }
+
+        /* An entry pointing to "auto" again would never be resolved */
+        if (key[0] == lenSignal && key[1] == lenSegment
+            && key[2] == lenOverlap && key[3] == nfft
+            && strcmp(window, windowType) == 0
+            && strcmp(entry.fftType, "auto") != 0) {
+            *profile = entry;
+            fclose(file);
+
+            return WELCH_SUCCESS;
+        }
+    }
+
+    fclose(file);
+
+    return WELCH_FAILURE;
+}
+
+/**
+ * Replace or add the entry of a shape in a profile file
+ */
+static welchStatus_t storeProfile(char *profilePath, int lenSignal,
+                                  int lenSegment, int lenOverlap,
+                                  char *windowType, int nfft,
+                                  welchProfile_t *profile)
+{
+    FILE *file, *temp;
+    char line[PROFILE_LINE];
+    char window[PROFILE_LINE];
+    char *tempPath;  /* Written first, then renamed to profilePath */
+    int key[4];
+
+    tempPath = (char*) malloc(strlen(profilePath) + sizeof(".tmp"));
+    if (tempPath == NULL) {
+        fprintf(stderr, "Failed to allocate memory in welchTune().\n");
+
+        return WELCH_FAILURE;
+    }
+    sprintf(tempPath, "%s.tmp", profilePath);
+
+    temp = fopen(tempPath, "w");
+    if (temp == NULL) {
+        fprintf(stderr, "Error in welchTune(): Failed to write %s.\n",
+                tempPath);
+
+        free(tempPath);
+
+        return WELCH_FAILURE;
+    }
+
+    /* Keep the entries of other shapes */
+    file = fopen(profilePath, "r");
+    if (file != NULL) {
+        while (fgets(line, sizeof(line), file) != NULL) {
+            if (sscanf(line, "%d %d %d %d %255s", &key[0], &key[1], &key[2],
+                       &key[3], window) == 5
+                && key[0] == lenSignal && key[1] == lenSegment
+                && key[2] == lenOverlap && key[3] == nfft
+                && strcmp(window, windowType) == 0) {
+                continue;
+            }
+            fputs(line, temp);
+        }
+        fclose(file);
+    }
+
+    fprintf(temp, "%d %d %d %d %s %s %d %d\n", lenSignal, lenSegment,
+            lenOverlap, nfft, windowType, profile->fftType,
+            profile->numThreads, profile->nfft);
+    fclose(temp);
+
+    if (rename(tempPath, profilePath) != 0) {
+        fprintf(stderr, "Error in welchTune(): Failed to write %s.\n",
+                profilePath);
+
+        remove(tempPath);
+        free(tempPath);
+
+        return WELCH_FAILURE;
+    }
+
+    free(tempPath);
+
+    return WELCH_SUCCESS;
+}
+
+welchStatus_t welchTune(double *signal, double samplingFrequency,
+                        int lenSignal, int lenSegment, int lenOverlap,
+                        char *windowType, int nfft, int allowPadding,
+                        char *profilePath, welchProfile_t *best)
+{
+    welchProfile_t bestInternal;
+    double *Pxx, *frequency;
+    double bestTime;     /* Time of the fastest candidate */
+    double time;         /* Best time of the current candidate */
+    double tic;
+    int nffts[2];        /* Candidate FFT lengths */
+    int numNfft;
+    int maxThreads;      /* Threads available to the caller */
+    int numThreads;
+    int lenPxx;
+    int type, n, r;
+    welchStatus_t status;
+
+    maxThreads = omp_get_max_threads();
+
+    nffts[0] = nfft;
+    numNfft = 1;
+    if (allowPadding && fastFftSize(nfft) != nfft) {
+        nffts[numNfft++] = fastFftSize(nfft);
+    }
+
+    bestTime = -1.0;
+    for (type = 0; type < NUM_FFT_TYPES; ++type) {
+        for (n = 0; n < numNfft; ++n) {
+            for (numThreads = 1; numThreads <= maxThreads;
+                 numThreads = numThreads < maxThreads
+                              && 2 * numThreads > maxThreads
+                              ? maxThreads : 2 * numThreads) {
+                omp_set_num_threads(numThreads);
+
+                time = -1.0;
+                for (r = 0; r < TUNE_REPEAT; ++r) {
+                    tic = omp_get_wtime();
+                    status = welch(signal, &Pxx, &frequency,
+                                   samplingFrequency, lenSignal, lenSegment,
+                                   lenOverlap, &lenPxx, windowType,
+                                   fftTypes[type], nffts[n]);
+                    tic = omp_get_wtime() - tic;
+
+                    /* Skip implementations that are not available */
+                    if (status != WELCH_SUCCESS) {
+                        time = -1.0;
+                        break;
+                    }
+
+                    free(Pxx);
+                    free(frequency);
+
+                    if (time < 0 || tic < time) {
+                        time = tic;
+                    }
+                }
+
+                if (time >= 0 && (bestTime < 0 || time < bestTime)) {
+                    bestTime = time;
+                    strcpy(bestInternal.fftType, fftTypes[type]);
+                    bestInternal.numThreads = numThreads;
+                    bestInternal.nfft = nffts[n];
+                }
+
+                /* Only the fftw routines use OpenMP threads */
+                if (strcmp(fftTypes[type], "fftw_openmp") != 0
+                    && strcmp(fftTypes[type], "fftw_numa") != 0) {
+                    break;
+                }
+            }
+        }
+    }
+
+    omp_set_num_threads(maxThreads);
+
+    if (bestTime < 0) {
+        fprintf(stderr, "Error in welchTune(): No configuration could be "
+                "run.\n");
+
+        return WELCH_FAILURE;
+    }
+
+    if (best != NULL) {
+        *best = bestInternal;
+    }
+
+    return storeProfile(profilePath, lenSignal, lenSegment, lenOverlap,
+                        windowType, nfft, &bestInternal);
+}
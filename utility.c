@@ -6,11 +6,22 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "welch.h"
 
 welchStatus_t getWindow(char *windowType, double *window, int lenWindow)
 {
-    /* TODO: Implement this function */
+    int i;
+
+    if (strcmp(windowType, "rectangular") == 0) {
+        for (i = 0; i < lenWindow; ++i) {
+            window[i] = 1.0;
+        }
+    } else {
+        fprintf(stderr, "Unrecoginzed type of window function.\n");
+
+        return WELCH_FAILURE;
+    }
 
     return WELCH_SUCCESS;
 }
@@ -45,3 +56,37 @@ welchStatus_t padZero(double *x, int n, double **xPadded, int nPadded)
 
     return WELCH_SUCCESS;
 }
+
+void addPeriodogram(double *xfft, int nfft, double *Pxx)
+{
+    int j;
+
+    Pxx[0] += xfft[0] * xfft[0];
+    for (j = 1; j <= (nfft - 1) / 2; ++j) {
+        Pxx[j] += xfft[2 * j - 1] * xfft[2 * j - 1]
+                  + xfft[2 * j] * xfft[2 * j];
+    }
+
+    /* If nfft is even, the last term is real and does not have a
+     * corresponding imaginary term */
+    if (nfft % 2 == 0) {
+        Pxx[nfft / 2] += xfft[nfft - 1] * xfft[nfft - 1];
+    }
+}
+
+void scalePeriodogram(double *Pxx, int nfft, double scale)
+{
+    int i;
+
+    /* Every frequency but DC and, for even nfft, Nyquist collects the power
+     * of its negative counterpart. For odd nfft the last frequency is below
+     * Nyquist and has a counterpart as well. */
+    Pxx[0] *= scale;
+    for (i = 1; i <= (nfft - 1) / 2; ++i) {
+        Pxx[i] *= scale * 2;
+    }
+
+    if (nfft % 2 == 0) {
+        Pxx[nfft / 2] *= scale;
+    }
+}
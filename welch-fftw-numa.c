@@ -0,0 +1,94 @@
+/**
+ * File: welch-fftw-numa.c
+ * Description: Benchmark the NUMA-aware mode of welch() against the fftw
+ *              OpenMP mode for increasing numbers of threads, so that scaling
+ *              past a single socket can be compared.
+ *
+ * Author: Xiaojun Wu <xiaojun.wu@nyu.edu>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include <numa.h>
+#include <omp.h>
+#include "welch.h"
+
+#define PI 3.1415926535897932384626
+#define N 16384
+#define NUM_REPEAT 64  /* Length of signal in units of N */
+
+int main(int argc, char *argv[])
+{
+    double *signal, *Pxx, *frequency;
+    int lenSignal, lenSegment, lenOverlap, lenPxx, nfft, samplingFrequency;
+    int maxThreads, numThreads, numNodes, mode;
+    int i;
+    char *modes[] = {"fftw_openmp", "fftw_numa"};
+    welchStatus_t status;
+    struct timeval tic, toc;  /* Start and finish time */
+    double total_time;
+
+    /* Set up variables */
+    lenSignal = N * NUM_REPEAT + N / 8;
+    lenSegment = N / 4;
+    lenOverlap = N / 8;
+    samplingFrequency = 1000;
+    nfft = N / 2;
+    maxThreads = omp_get_max_threads();
+    numNodes = numa_available() < 0 ? 1 : numa_num_configured_nodes();
+
+    /* Generate input signal */
+    signal = malloc(lenSignal * sizeof(double));
+    if (signal == NULL) {
+        fprintf(stderr, "Welch test error: Failed to allocate memory for "
+                "signals.\n");
+
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < lenSignal; ++i) {
+        signal[i] = 5 * sin(2 * PI * i / N);
+    }
+
+    printf("%d NUMA node(s), up to %d threads.\n", numNodes, maxThreads);
+
+    for (numThreads = 1; ; numThreads *= 2) {
+        if (numThreads > maxThreads) {
+            numThreads = maxThreads;
+        }
+        omp_set_num_threads(numThreads);
+
+        for (mode = 0; mode < 2; ++mode) {
+            /* Run the algorithm */
+            gettimeofday(&tic, NULL);
+            status = welch(signal, &Pxx, &frequency, samplingFrequency,
+                           lenSignal, lenSegment, lenOverlap, &lenPxx,
+                           "rectangular", modes[mode], nfft);
+            gettimeofday(&toc, NULL);
+
+            /* Print time spent on the Welch method */
+            if (status == WELCH_SUCCESS) {
+                total_time = toc.tv_sec - tic.tv_sec
+                             + (toc.tv_usec - tic.tv_usec) / 1e6;
+                printf("%-12s %3d threads: completed in %.8f seconds.\n",
+                       modes[mode], numThreads, total_time);
+
+                free(Pxx);
+                free(frequency);
+            } else {
+                printf("%-12s %3d threads: Welch method failed.\n",
+                       modes[mode], numThreads);
+            }
+        }
+
+        if (numThreads == maxThreads) {
+            break;
+        }
+    }
+
+    free(signal);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+/**
+ * File: welch-fftw-pipeline.c
+ * Description: Test the welchFile() function, which overlaps reading a signal
+ *              from a file with computing its segments.
+ *
+ * Author: Xiaojun Wu <xiaojun.wu@nyu.edu>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include "welch.h"
+
+#define PI 3.1415926535897932384626
+#define N 16384
+#define NUM_BLOCKS_IN_FILE 256
+#define FILENAME "welch-pipeline.dat"
+
+int main(int argc, char *argv[])
+{
+    double *signal, *Pxx, *frequency;
+    int lenSignal, lenSegment, lenOverlap, lenPxx, nfft, samplingFrequency;
+    int i;
+    FILE *file;
+    welchStatus_t status;
+    welchPipelineStats_t stats;
+    struct timeval tic, toc;  /* Start and finish time */
+    double total_time;
+
+    /* Set up variables */
+    lenSignal = N;
+    lenSegment = N / 4;
+    lenOverlap = N / 8;
+    samplingFrequency = 1000;
+    nfft = N / 2;
+
+    /* Generate input signal and store it in a file */
+    signal = malloc(lenSignal * sizeof(double));
+    if (signal == NULL) {
+        fprintf(stderr, "Welch test error: Failed to allocate memory for "
+                "signals.\n");
+
+        return EXIT_FAILURE;
+    }
+
+    file = fopen(FILENAME, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Welch test error: Failed to create %s.\n", FILENAME);
+
+        free(signal);
+
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < NUM_BLOCKS_IN_FILE * lenSignal; ++i) {
+        signal[i % lenSignal] = 5 * sin(2 * PI * i / N);
+        if (i % lenSignal == lenSignal - 1) {
+            fwrite(signal, sizeof(double), lenSignal, file);
+        }
+    }
+    /* Make the number of segments integral */
+    fwrite(signal, sizeof(double), lenOverlap, file);
+    fclose(file);
+
+    /* Run the algorithm */
+    gettimeofday(&tic, NULL);
+    status = welchFile(FILENAME, &Pxx, &frequency, samplingFrequency,
+                       lenSegment, lenOverlap, &lenPxx, "rectangular",
+                       "fftw", nfft, 4 * lenSignal, &stats);
+    gettimeofday(&toc, NULL);
+
+    /* Print time spent on the Welch method */
+    if (status == WELCH_SUCCESS) {
+        total_time = toc.tv_sec - tic.tv_sec
+                     + (toc.tv_usec - tic.tv_usec) / 1e6;
+        printf("Welch method completed in %.8f seconds.\n", total_time);
+        printf("Reader: %.8f seconds reading, %ld stalls (%.8f seconds).\n",
+               stats.readTime, stats.readerStalls, stats.readerStallTime);
+        printf("Compute: %.8f seconds computing, %ld stalls (%.8f seconds).\n",
+               stats.computeTime, stats.computeStalls,
+               stats.computeStallTime);
+
+        free(Pxx);
+        free(frequency);
+    } else {
+        printf("Welch method failed.\n");
+    }
+
+    remove(FILENAME);
+    free(signal);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+/**
+ * File: welch-fftw-realtime.c
+ * Description: Test the real-time mode of the Welch method. The main thread
+ *              acts as an acquisition device pushing blocks at the sampling
+ *              rate, and latency statistics are printed at the end.
+ *
+ * Author: Xiaojun Wu <xiaojun.wu@nyu.edu>
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "welch.h"
+
+#define PI 3.1415926535897932384626
+#define N 16384
+#define NUM_BLOCKS 2000  /* Number of blocks to push */
+#define IDLE_SLEEP 20e-6 /* Sleep of the idle consumer, 0 to spin */
+
+int main(int argc, char *argv[])
+{
+    welchRealtime_t *rt;
+    double *block, *Pxx;
+    int lenSegment, lenOverlap, lenHop, nfft, samplingFrequency;
+    int i, k;
+    long numUpdate, overruns, dropped;
+    struct timespec period;  /* Time between two blocks */
+    welchStatus_t status;
+
+    /* Set up variables */
+    lenSegment = N / 4;
+    lenOverlap = N / 8;
+    lenHop = lenSegment - lenOverlap;
+    samplingFrequency = 1000000;
+    nfft = N / 2;
+    period.tv_sec = 0;
+    period.tv_nsec = 1000000000L / samplingFrequency * lenHop;
+
+    status = welchRealtimeCreate(&rt, samplingFrequency, lenSegment,
+                                 lenOverlap, "rectangular", nfft, 16,
+                                 (double) lenHop / samplingFrequency,
+                                 IDLE_SLEEP);
+    if (status != WELCH_SUCCESS) {
+        printf("Welch method failed.\n");
+
+        return EXIT_FAILURE;
+    }
+
+    block = malloc(lenHop * sizeof(double));
+    Pxx = malloc(welchRealtimeLenPxx(rt) * sizeof(double));
+    if (block == NULL || Pxx == NULL) {
+        fprintf(stderr, "Welch test error: Failed to allocate memory for "
+                "signals.\n");
+
+        free(block);
+        free(Pxx);
+        welchRealtimeDestroy(rt);
+
+        return EXIT_FAILURE;
+    }
+
+    /* Push blocks of the signal at the sampling rate */
+    for (k = 0; k < NUM_BLOCKS; ++k) {
+        for (i = 0; i < lenHop; ++i) {
+            block[i] = 5 * sin(2 * PI * ((long) k * lenHop + i) / N);
+        }
+
+        welchRealtimePush(rt, block);
+        nanosleep(&period, NULL);
+    }
+
+    /* Print latency statistics */
+    welchRealtimeCounters(rt, &numUpdate, &overruns, &dropped);
+    printf("%ld updates, %ld overruns, %ld dropped blocks.\n", numUpdate,
+           overruns, dropped);
+    printf("Latency: p50 %.8f, p99 %.8f, p99.9 %.8f, max %.8f seconds.\n",
+           welchRealtimeLatency(rt, 50), welchRealtimeLatency(rt, 99),
+           welchRealtimeLatency(rt, 99.9), welchRealtimeLatency(rt, 100));
+
+    if (welchRealtimeGetPxx(rt, Pxx, NULL, NULL) != WELCH_SUCCESS) {
+        printf("Welch method failed.\n");
+    }
+
+    free(block);
+    free(Pxx);
+    welchRealtimeDestroy(rt);
+
+    return EXIT_SUCCESS;
+}
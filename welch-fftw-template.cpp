@@ -0,0 +1,108 @@
+/**
+ * File: welch-fftw-template.cpp
+ * Description: Test the compile-time specialized C++ interface of welch.hpp
+ *              against welch() with the same parameters.
+ *
+ * Author: Xiaojun Wu <xiaojun.wu@nyu.edu>
+ */
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/time.h>
+#include "welch.hpp"
+
+#define PI 3.1415926535897932384626
+#define N 16384
+
+/* Same parameters as the other test programs */
+typedef welchpp::Welch<N / 2, N / 4, N / 8> EvenWelch;
+typedef welchpp::Welch<N / 2 - 1, N / 4, N / 8> OddWelch;
+
+/**
+ * Run a fixed configuration and compare it with welch()
+ *
+ * Returns the largest difference relative to the peak, or a negative number
+ * if either method failed
+ */
+template <class Estimator, int Nfft>
+static double compare(double *signal, int lenSignal, double samplingFrequency)
+{
+    static Estimator welchFixed;
+    static double PxxFixed[Estimator::lenPxx];
+    double *Pxx, *frequency;
+    double peak, error;
+    int lenPxx;
+    struct timeval tic, toc;
+
+    gettimeofday(&tic, NULL);
+    if (welchFixed(signal, lenSignal, samplingFrequency, PxxFixed)
+        != WELCH_SUCCESS) {
+        return -1.0;
+    }
+    gettimeofday(&toc, NULL);
+    printf("nfft = %d: Welch template completed in %.8f seconds.\n", Nfft,
+           toc.tv_sec - tic.tv_sec + (toc.tv_usec - tic.tv_usec) / 1e6);
+
+    if (welch(signal, &Pxx, &frequency, samplingFrequency, lenSignal, N / 4,
+              N / 8, &lenPxx, (char*) "rectangular", (char*) "fftw", Nfft)
+        != WELCH_SUCCESS || lenPxx != Estimator::lenPxx) {
+        return -1.0;
+    }
+
+    peak = 0.0;
+    error = 0.0;
+    for (int i = 0; i < lenPxx; ++i) {
+        peak = std::fmax(peak, Pxx[i]);
+        error = std::fmax(error, std::fabs(Pxx[i] - PxxFixed[i]));
+    }
+
+    free(Pxx);
+    free(frequency);
+
+    return error / peak;
+}
+
+int main(int argc, char *argv[])
+{
+    double *signal;
+    double errors[2];
+    int lenSignal, samplingFrequency;
+    int i;
+
+    /* Set up variables */
+    lenSignal = N;
+    samplingFrequency = 1000;
+
+    /* Generate input signal */
+    signal = (double*) malloc(lenSignal * sizeof(double));
+    if (signal == NULL) {
+        fprintf(stderr, "Welch test error: Failed to allocate memory for "
+                "signals.\n");
+
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < lenSignal; ++i) {
+        signal[i] = 5 * sin(2 * PI * i / N);
+    }
+
+    errors[0] = compare<EvenWelch, N / 2>(signal, lenSignal,
+                                          samplingFrequency);
+    errors[1] = compare<OddWelch, N / 2 - 1>(signal, lenSignal,
+                                             samplingFrequency);
+
+    free(signal);
+
+    for (i = 0; i < 2; ++i) {
+        if (errors[i] < 0 || errors[i] > 1e-12) {
+            printf("Welch template differs from welch().\n");
+
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("Welch template matches welch() within %.3e.\n",
+           std::fmax(errors[0], errors[1]));
+
+    return EXIT_SUCCESS;
+}
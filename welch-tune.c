@@ -0,0 +1,89 @@
+/**
+ * File: welch-tune.c
+ * Description: Tune welch() for the parameters of the test programs, then
+ *              compare the tuned configuration with plain fftw.
+ *
+ * Author: Xiaojun Wu <xiaojun.wu@nyu.edu>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include "welch.h"
+
+#define PI 3.1415926535897932384626
+#define N 16384
+
+int main(int argc, char *argv[])
+{
+    double *signal, *Pxx, *frequency;
+    int lenSignal, lenSegment, lenOverlap, lenPxx, nfft, samplingFrequency;
+    int i, mode;
+    char *modes[] = {"fftw", "auto"};
+    welchProfile_t profile;
+    welchStatus_t status;
+    struct timeval tic, toc;  /* Start and finish time */
+    double total_time;
+
+    /* Set up variables. nfft is prime, so padding it pays off. */
+    lenSignal = N;
+    lenSegment = N / 4;
+    lenOverlap = N / 8;
+    samplingFrequency = 1000;
+    nfft = N / 2 - 1;
+
+    /* Generate input signal */
+    signal = malloc(lenSignal * sizeof(double));
+    if (signal == NULL) {
+        fprintf(stderr, "Welch test error: Failed to allocate memory for "
+                "signals.\n");
+
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < lenSignal; ++i) {
+        signal[i] = 5 * sin(2 * PI * i / N);
+    }
+
+    /* Tune */
+    status = welchTune(signal, samplingFrequency, lenSignal, lenSegment,
+                       lenOverlap, "rectangular", nfft, 1, welchProfilePath(),
+                       &profile);
+    if (status != WELCH_SUCCESS) {
+        printf("Tuning failed.\n");
+
+        free(signal);
+
+        return EXIT_FAILURE;
+    }
+    printf("Tuned: %s with %d threads and nfft = %d, stored in %s.\n",
+           profile.fftType, profile.numThreads, profile.nfft,
+           welchProfilePath());
+
+    for (mode = 0; mode < 2; ++mode) {
+        /* Run the algorithm */
+        gettimeofday(&tic, NULL);
+        status = welch(signal, &Pxx, &frequency, samplingFrequency, lenSignal,
+                       lenSegment, lenOverlap, &lenPxx, "rectangular",
+                       modes[mode], nfft);
+        gettimeofday(&toc, NULL);
+
+        /* Print time spent on the Welch method */
+        if (status == WELCH_SUCCESS) {
+            total_time = toc.tv_sec - tic.tv_sec
+                         + (toc.tv_usec - tic.tv_usec) / 1e6;
+            printf("%-5s: Welch method completed in %.8f seconds.\n",
+                   modes[mode], total_time);
+
+            free(Pxx);
+            free(frequency);
+        } else {
+            printf("%-5s: Welch method failed.\n", modes[mode]);
+        }
+    }
+
+    free(signal);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,723 @@
+/**
+ * File: welch-validate.c
+ * Description: Validate every execution path of the Welch method against a
+ *              reference computed with a naive DFT in long double, on
+ *              synthetic signals with known spectra. Errors, Parseval energy
+ *              error and throughput are printed side by side, and the program
+ *              fails if the error of a path exceeds its tolerance. Throughput
+ *              only times the estimation step of each path: writing the file
+ *              of welchFile(), editing the signal of the incremental cache
+ *              and starting the real-time consumer are excluded.
+ *
+ * Author: Xiaojun Wu <xiaojun.wu@nyu.edu>
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sched.h>
+#include <time.h>
+#include "welch.h"
+
+#define PI 3.1415926535897932384626L
+#define LEN_SEGMENT 256
+#define LEN_OVERLAP 128
+#define LEN_SIGNAL (LEN_OVERLAP + 63 * (LEN_SEGMENT - LEN_OVERLAP))
+#define SAMPLING_FREQUENCY 1000.0
+#define NUM_REPEAT 3
+#define FILENAME "welch-validate.dat"
+#define PROFILE "welch-validate.profile"
+#define REALTIME_TIMEOUT 10.0   /* Seconds the real-time mode may take */
+
+#define DECIMATION 16           /* Decimation factor of welchDecimated() */
+#define DECIMATED_NFFT 128      /* Segment length and nfft after decimation */
+#define IN_BAND_TOLERANCE 0.05  /* Largest in-band power error in dB */
+#define ALIAS_REJECTION -70.0   /* Largest power of an alias in dB */
+
+#define MULTITAPER_LENGTH 4096  /* Length of the multitaper record */
+#define MULTITAPER_NW 4.0       /* Time half-bandwidth product */
+#define MULTITAPER_K 7          /* Number of tapers */
+#define DPSS_TOLERANCE 1e-10    /* Largest orthonormality and eigen-residual */
+#define PARSEVAL_TOLERANCE 1e-12 /* Largest Parseval error of multitaper() */
+#define NOISE_TOLERANCE 0.05    /* Largest relative error of the noise level */
+
+/**
+ * Interfaces through which a path is run
+ */
+typedef enum {
+    PATH_WELCH,        /* welch() with the path name as fftType */
+    PATH_FILE,         /* welchFile() */
+    PATH_INCREMENTAL,  /* welchCache_t */
+    PATH_REALTIME      /* welchRealtime_t */
+} pathKind_t;
+
+/**
+ * An execution path and the largest error it may have, relative to the
+ * peak of the reference
+ */
+typedef struct {
+    char *name;
+    pathKind_t kind;
+    double tolerance;
+    int optional;  /* Hardware may be missing, so failing to run is fine */
+} path_t;
+
+static path_t paths[] = {
+    {"fftw", PATH_WELCH, 1e-12, 0},
+    {"fftw_openmp", PATH_WELCH, 1e-12, 0},
+    {"fftw_numa", PATH_WELCH, 1e-12, 0},
+    {"cufft", PATH_WELCH, 1e-12, 1},
+    {"auto", PATH_WELCH, 1e-12, 0},
+    {"pipeline", PATH_FILE, 1e-12, 0},
+    {"incremental", PATH_INCREMENTAL, 1e-11, 0},
+    {"realtime", PATH_REALTIME, 1e-12, 0}
+};
+
+#define NUM_PATHS ((int) (sizeof(paths) / sizeof(paths[0])))
+
+/**
+ * Synthetic signals
+ */
+static void makeSignal(int type, double *signal, int n)
+{
+    unsigned long state = 12345;  /* Linear congruential generator */
+    int i;
+
+    for (i = 0; i < n; ++i) {
+        switch (type) {
+        case 0:
+            /* Sinusoid centered on a frequency bin of nfft = 256 */
+            signal[i] = 5 * sin(2 * PI * 32 * i / 256);
+            break;
+        case 1:
+            /* DC plus two sinusoids off the bins */
+            signal[i] = 1.5 + 3 * sin(2 * PI * 101.3 * i / SAMPLING_FREQUENCY)
+                        + 0.5 * cos(2 * PI * 333.3 * i / SAMPLING_FREQUENCY);
+            break;
+        default:
+            /* White noise, uniform in [-1, 1] */
+            state = state * 6364136223846793005UL + 1442695040888963407UL;
+            signal[i] = (double) (state >> 11) / (1UL << 53) * 2 - 1;
+            break;
+        }
+    }
+}
+
+/**
+ * The Welch method with a naive DFT in long double and the textbook one-sided
+ * scaling: every frequency but DC and the Nyquist frequency of an even nfft
+ * also carries the power of its negative counterpart. Also returns the mean
+ * energy of the windowed segments, which is what the estimate integrates to
+ * by Parseval's theorem.
+ */
+static int reference(double *signal, int n, int nfft, long double *Pxx,
+                     long double *energy)
+{
+    long double *c, *s;  /* Twiddle factors */
+    long double re, im, norm, x;
+    double window[LEN_SEGMENT];
+    int lenPxx, numSegment;
+    int start, k, j;
+
+    lenPxx = nfft % 2 == 0 ? nfft / 2 + 1 : (nfft + 1) / 2;
+    c = malloc(nfft * sizeof(long double));
+    s = malloc(nfft * sizeof(long double));
+    if (c == NULL || s == NULL) {
+        free(c);
+        free(s);
+
+        return 0;
+    }
+
+    for (k = 0; k < nfft; ++k) {
+        c[k] = cosl(2 * PI * k / nfft);
+        s[k] = sinl(2 * PI * k / nfft);
+    }
+
+    getWindow("rectangular", window, LEN_SEGMENT);
+    norm = 0.0L;
+    for (j = 0; j < LEN_SEGMENT; ++j) {
+        norm += (long double) window[j] * window[j];
+    }
+
+    for (k = 0; k < lenPxx; ++k) {
+        Pxx[k] = 0.0L;
+    }
+    *energy = 0.0L;
+
+    numSegment = 0;
+    for (start = 0; start + LEN_SEGMENT <= n;
+         start += LEN_SEGMENT - LEN_OVERLAP) {
+        for (k = 0; k < lenPxx; ++k) {
+            re = 0.0L;
+            im = 0.0L;
+            for (j = 0; j < LEN_SEGMENT; ++j) {
+                x = (long double) signal[start + j] * window[j];
+                re += x * c[(long) k * j % nfft];
+                im -= x * s[(long) k * j % nfft];
+            }
+            Pxx[k] += re * re + im * im;
+        }
+
+        for (j = 0; j < LEN_SEGMENT; ++j) {
+            x = (long double) signal[start + j] * window[j];
+            *energy += x * x;
+        }
+
+        ++numSegment;
+    }
+
+    for (k = 0; k < lenPxx; ++k) {
+        Pxx[k] /= SAMPLING_FREQUENCY * norm * numSegment;
+        if (k != 0 && 2 * k != nfft) {
+            Pxx[k] *= 2;
+        }
+    }
+    *energy /= norm * numSegment;
+
+    free(c);
+    free(s);
+
+    return 1;
+}
+
+static double now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/**
+ * Run the real-time mode on a whole signal and wait for all segments. Fails
+ * if a block is dropped or the segments are not done within
+ * REALTIME_TIMEOUT seconds. seconds is the time from the first push to the
+ * last update.
+ */
+static welchStatus_t runRealtime(double *signal, int n, int nfft,
+                                 double **Pxx, int *lenPxx, double *seconds)
+{
+    welchRealtime_t *rt;
+    long numUpdate, overruns, dropped, expected;
+    int hop, k;
+    double start;
+    welchStatus_t status;
+
+    hop = LEN_SEGMENT - LEN_OVERLAP;
+    expected = (n - LEN_OVERLAP) / hop;
+
+    /* The ring holds the whole signal, so no block has to be dropped */
+    if (welchRealtimeCreate(&rt, SAMPLING_FREQUENCY, LEN_SEGMENT, LEN_OVERLAP,
+                            "rectangular", nfft, n / hop, 1.0, 20e-6)
+        != WELCH_SUCCESS) {
+        return WELCH_FAILURE;
+    }
+
+    *lenPxx = welchRealtimeLenPxx(rt);
+    *Pxx = malloc(*lenPxx * sizeof(double));
+    if (*Pxx == NULL) {
+        welchRealtimeDestroy(rt);
+
+        return WELCH_FAILURE;
+    }
+
+    status = WELCH_SUCCESS;
+    start = now();
+    for (k = 0; k < n / hop && status == WELCH_SUCCESS; ++k) {
+        status = welchRealtimePush(rt, signal + (long) k * hop);
+    }
+
+    /* Yield rather than sleep, so that polling adds little to the time */
+    while (status == WELCH_SUCCESS) {
+        welchRealtimeCounters(rt, &numUpdate, &overruns, &dropped);
+        if (numUpdate >= expected) {
+            *seconds = now() - start;
+            status = welchRealtimeGetPxx(rt, *Pxx, NULL, NULL);
+            break;
+        }
+        if (now() - start > REALTIME_TIMEOUT) {
+            fprintf(stderr, "Welch test error: The real-time mode did not "
+                    "finish in time.\n");
+
+            status = WELCH_FAILURE;
+        }
+        sched_yield();
+    }
+
+    welchRealtimeDestroy(rt);
+
+    if (status != WELCH_SUCCESS) {
+        free(*Pxx);
+    }
+
+    return status;
+}
+
+/**
+ * Power in dB, relative to a sinusoid of unit amplitude, of the frequency bin
+ * k of an estimate of welchDecimated()
+ */
+static double binPower(double *signal, int n, int k, int *lenPxx)
+{
+    double *Pxx, *frequency;
+    double power;
+
+    if (welchDecimated(signal, &Pxx, &frequency,
+                       SAMPLING_FREQUENCY * DECIMATION, n, DECIMATED_NFFT,
+                       DECIMATED_NFFT / 2, lenPxx, "rectangular", "fftw",
+                       DECIMATED_NFFT, DECIMATION) != WELCH_SUCCESS) {
+        return NAN;
+    }
+
+    power = Pxx[k] * (frequency[1] - frequency[0]) / 0.5;
+
+    free(Pxx);
+    free(frequency);
+
+    return 10 * log10(power);
+}
+
+/**
+ * Check welchDecimated(). Sinusoids centered on frequency bins inside the
+ * returned band must keep their power, and a sinusoid above the reduced
+ * Nyquist frequency must not show up at its alias.
+ */
+static int validateDecimation(void)
+{
+    double *signal;
+    double inBand[2], alias;
+    long double t;
+    int n, lenPxx, lenExpected;
+    int bins[2] = {20, 51};  /* At 31% and 80% of the reduced Nyquist */
+    int aliasBin = 36;       /* Alias of a sinusoid at 144% */
+    int ok;
+    int i;
+
+    n = DECIMATION * (DECIMATED_NFFT / 2) * (DECIMATED_NFFT / 4 + 1);
+    signal = malloc(n * sizeof(double));
+    if (signal == NULL) {
+        return 0;
+    }
+
+    /* A bin is SAMPLING_FREQUENCY / DECIMATED_NFFT wide at the reduced rate,
+     * and the original rate is DECIMATION * SAMPLING_FREQUENCY */
+    for (i = 0; i < n; ++i) {
+        t = (long double) i / (DECIMATION * DECIMATED_NFFT);
+        signal[i] = sinl(2 * PI * bins[0] * t)
+                    + 0.5 * sinl(2 * PI * bins[1] * t);
+    }
+    inBand[0] = binPower(signal, n, bins[0], &lenPxx);
+    inBand[1] = binPower(signal, n, bins[1], &lenPxx) - 20 * log10(0.5);
+
+    for (i = 0; i < n; ++i) {
+        t = (long double) i / (DECIMATION * DECIMATED_NFFT);
+        signal[i] = sinl(2 * PI * (DECIMATED_NFFT - aliasBin) * t);
+    }
+    alias = binPower(signal, n, aliasBin, &lenPxx);
+
+    free(signal);
+
+    lenExpected = (int) (0.8 * DECIMATED_NFFT / 2) + 1;
+    ok = fabs(inBand[0]) <= IN_BAND_TOLERANCE
+         && fabs(inBand[1]) <= IN_BAND_TOLERANCE
+         && alias <= ALIAS_REJECTION && lenPxx == lenExpected;
+
+    printf("decimated by %d: in-band %+.3f dB at 31%%, %+.3f dB at 80%%, "
+           "alias %.1f dB, %d bins: %s\n", DECIMATION, inBand[0], inBand[1],
+           alias, lenPxx, ok ? "OK" : "FAILED");
+
+    return ok;
+}
+
+/**
+ * Check multitaper() on white noise, uniform in [-1, 1], for one nfft. The
+ * equal-weight estimate must integrate to the mean energy of the tapered
+ * copies by Parseval's theorem, and the mean level below the Nyquist
+ * frequency of both the equal-weight and the adaptive estimate must be
+ * 2 * variance / fs.
+ */
+static int validateMultitaper(double *signal, double *tapers, int nfft,
+                              double *parsevalError, double *noiseError)
+{
+    double *Pxx, *frequency;
+    long double energy, sum, level;
+    double x;
+    int lenPxx, adaptive, numBin;
+    int i, k;
+
+    energy = 0.0L;
+    for (k = 0; k < MULTITAPER_K; ++k) {
+        for (i = 0; i < MULTITAPER_LENGTH; ++i) {
+            x = signal[i] * tapers[(long) k * MULTITAPER_LENGTH + i];
+            energy += (long double) x * x;
+        }
+    }
+    energy /= MULTITAPER_K;
+
+    *parsevalError = 0.0;
+    *noiseError = 0.0;
+    for (adaptive = 0; adaptive < 2; ++adaptive) {
+        if (multitaper(signal, &Pxx, &frequency, SAMPLING_FREQUENCY,
+                       MULTITAPER_LENGTH, &lenPxx, MULTITAPER_NW,
+                       MULTITAPER_K, adaptive, "fftw", nfft)
+            != WELCH_SUCCESS) {
+            return 0;
+        }
+
+        sum = 0.0L;
+        level = 0.0L;
+        numBin = 0;
+        for (k = 0; k < lenPxx; ++k) {
+            sum += Pxx[k];
+            if (k > 0 && 2 * k != nfft) {
+                level += Pxx[k];
+                ++numBin;
+            }
+        }
+        sum *= SAMPLING_FREQUENCY / nfft;
+        level /= numBin;
+
+        if (!adaptive) {
+            *parsevalError = fabsl(sum - energy) / energy;
+        }
+        x = fabsl(level * SAMPLING_FREQUENCY * 3 / 2 - 1);
+        if (x > *noiseError) {
+            *noiseError = x;
+        }
+
+        free(Pxx);
+        free(frequency);
+    }
+
+    return 1;
+}
+
+/**
+ * Check dpss() and multitaper(). The tapers must be orthonormal eigenvectors
+ * of the tridiagonal matrix defining them, and multitaper() must pass
+ * validateMultitaper() for even and odd nfft.
+ */
+static int validateTapers(void)
+{
+    double *signal, *tapers, *v;
+    double lambda[MULTITAPER_K];
+    double w, theta, bound, dot, row;
+    double orthoError, residualError, residual;
+    double parsevalError, noiseError;
+    int nffts[] = {MULTITAPER_LENGTH, MULTITAPER_LENGTH + 1};
+    int n, ok;
+    int i, k, m;
+
+    n = MULTITAPER_LENGTH;
+    signal = malloc(n * sizeof(double));
+    tapers = malloc((long) MULTITAPER_K * n * sizeof(double));
+    if (signal == NULL || tapers == NULL
+        || dpss(n, MULTITAPER_NW, MULTITAPER_K, tapers, lambda)
+           != WELCH_SUCCESS) {
+        free(signal);
+        free(tapers);
+
+        return 0;
+    }
+
+    orthoError = 0.0;
+    for (k = 0; k < MULTITAPER_K; ++k) {
+        for (m = 0; m <= k; ++m) {
+            dot = 0.0;
+            for (i = 0; i < n; ++i) {
+                dot += tapers[(long) k * n + i] * tapers[(long) m * n + i];
+            }
+            orthoError = fmax(orthoError, fabs(dot - (k == m)));
+        }
+    }
+
+    /* Residual of T v = theta v, with the Rayleigh quotient as theta and
+     * relative to the largest entry of T. T has diagonal
+     * ((n - 1 - 2i) / 2)^2 cos(2 pi W) and off-diagonal i (n - i) / 2. */
+    w = MULTITAPER_NW / n;
+    bound = (n - 1.0) * (n - 1.0) / 4;
+    residualError = 0.0;
+    for (k = 0; k < MULTITAPER_K; ++k) {
+        v = tapers + (long) k * n;
+        for (m = 0; m < 2; ++m) {
+            if (m == 0) {
+                theta = 0.0;
+            }
+            residual = 0.0;
+            for (i = 0; i < n; ++i) {
+                row = (n - 1 - 2.0 * i) * (n - 1 - 2.0 * i) / 4
+                      * cos(2 * PI * w) * v[i];
+                if (i > 0) {
+                    row += i * (n - (double) i) / 2 * v[i - 1];
+                }
+                if (i + 1 < n) {
+                    row += (i + 1) * (n - (double) (i + 1)) / 2 * v[i + 1];
+                }
+
+                if (m == 0) {
+                    theta += row * v[i];
+                } else {
+                    residual += (row - theta * v[i]) * (row - theta * v[i]);
+                }
+            }
+        }
+        residualError = fmax(residualError, sqrt(residual) / bound);
+    }
+
+    ok = orthoError <= DPSS_TOLERANCE && residualError <= DPSS_TOLERANCE;
+    printf("dpss NW = %.1f, K = %d: orthonormality %.3e, residual %.3e: "
+           "%s\n", MULTITAPER_NW, MULTITAPER_K, orthoError, residualError,
+           ok ? "OK" : "FAILED");
+
+    makeSignal(2, signal, n);
+    for (i = 0; i < 2; ++i) {
+        if (!validateMultitaper(signal, tapers, nffts[i], &parsevalError,
+                                &noiseError)) {
+            printf("multitaper nfft = %d: FAILED\n", nffts[i]);
+            ok = 0;
+            continue;
+        }
+
+        printf("multitaper nfft = %d: parseval %.3e, noise level %.3e: %s\n",
+               nffts[i], parsevalError, noiseError,
+               parsevalError <= PARSEVAL_TOLERANCE
+               && noiseError <= NOISE_TOLERANCE ? "OK" : "FAILED");
+        if (parsevalError > PARSEVAL_TOLERANCE
+            || noiseError > NOISE_TOLERANCE) {
+            ok = 0;
+        }
+    }
+
+    multitaperCleanup();
+    free(signal);
+    free(tapers);
+
+    return ok;
+}
+
+/**
+ * Run one execution path. seconds is the time of the estimation step alone.
+ */
+static welchStatus_t runPath(path_t *path, double *signal, int n, int nfft,
+                             double **Pxx, int *lenPxx, double *seconds)
+{
+    welchCache_t *cache;
+    double *frequency;
+    double start;
+    FILE *file;
+    welchStatus_t status;
+
+    frequency = NULL;
+    *seconds = 0.0;
+
+    switch (path->kind) {
+    case PATH_FILE:
+        file = fopen(FILENAME, "wb");
+        if (file == NULL) {
+            return WELCH_FAILURE;
+        }
+        fwrite(signal, sizeof(double), n, file);
+        fclose(file);
+
+        start = now();
+        status = welchFile(FILENAME, Pxx, &frequency, SAMPLING_FREQUENCY,
+                           LEN_SEGMENT, LEN_OVERLAP, lenPxx, "rectangular",
+                           "fftw", nfft, 1000, NULL);
+        *seconds = now() - start;
+        remove(FILENAME);
+        break;
+    case PATH_INCREMENTAL:
+        /* Creating the cache estimates the whole signal, which is what is
+         * timed. Then the first segments are edited and restored
+         * incrementally, and the estimate must be unchanged. */
+        start = now();
+        status = welchCacheCreate(&cache, signal, SAMPLING_FREQUENCY, n,
+                                  LEN_SEGMENT, LEN_OVERLAP, "rectangular",
+                                  nfft);
+        *seconds = now() - start;
+        if (status != WELCH_SUCCESS) {
+            break;
+        }
+        signal[100] += 1.0;
+        welchCacheUpdate(cache, signal, 100, 101, NULL);
+        signal[100] -= 1.0;
+        welchCacheUpdate(cache, signal, 100, 101, NULL);
+        status = welchCacheGetPxx(cache, Pxx, &frequency, lenPxx);
+        welchCacheDestroy(cache);
+        break;
+    case PATH_REALTIME:
+        status = runRealtime(signal, n, nfft, Pxx, lenPxx, seconds);
+        break;
+    default:
+        start = now();
+        status = welch(signal, Pxx, &frequency, SAMPLING_FREQUENCY, n,
+                       LEN_SEGMENT, LEN_OVERLAP, lenPxx, "rectangular",
+                       path->name, nfft);
+        *seconds = now() - start;
+        break;
+    }
+
+    free(frequency);
+
+    return status;
+}
+
+int main(int argc, char *argv[])
+{
+    char *signalNames[] = {"sinusoid", "off-bin", "noise"};
+    int nffts[] = {256, 300, 257};
+    double *signal, *Pxx;
+    long double *Pref;
+    long double energy;       /* Energy expected by Parseval's theorem */
+    long double sum;          /* Energy of an estimate */
+    double maxError;          /* Largest error relative to the peak */
+    double relError;          /* Largest error relative to each bin */
+    double parsevalError;
+    double peak, error, throughput;
+    double seconds, elapsed;  /* Time of the estimation step */
+    int lenPxx, lenRef;
+    int failed;
+    int type, n, path, r, k;
+    welchStatus_t status;
+
+    signal = malloc(LEN_SIGNAL * sizeof(double));
+    Pref = malloc((LEN_SEGMENT + 1) * 2 * sizeof(long double));
+    if (signal == NULL || Pref == NULL) {
+        fprintf(stderr, "Welch test error: Failed to allocate memory for "
+                "signals.\n");
+
+        return EXIT_FAILURE;
+    }
+
+    failed = 0;
+
+    /* Tune every nfft, so that the "auto" path runs a tuned configuration
+     * rather than its fallback. Padding would change the frequencies. */
+    setenv("WELCH_PROFILE", PROFILE, 1);
+    makeSignal(2, signal, LEN_SIGNAL);
+    for (n = 0; n < 3; ++n) {
+        if (welchTune(signal, SAMPLING_FREQUENCY, LEN_SIGNAL, LEN_SEGMENT,
+                      LEN_OVERLAP, "rectangular", nffts[n], 0, PROFILE, NULL)
+            != WELCH_SUCCESS) {
+            fprintf(stderr, "Welch test error: Failed to tune nfft = %d.\n",
+                    nffts[n]);
+
+            failed = 1;
+        }
+    }
+
+    printf("%-9s %5s %-12s %10s %10s %10s %14s %s\n", "signal", "nfft",
+           "path", "max err", "rel err", "parseval", "samples/s", "result");
+
+    for (type = 0; type < 3; ++type) {
+        for (n = 0; n < 3; ++n) {
+            makeSignal(type, signal, LEN_SIGNAL);
+            if (!reference(signal, LEN_SIGNAL, nffts[n], Pref, &energy)) {
+                fprintf(stderr, "Welch test error: Failed to compute "
+                        "reference.\n");
+
+                return EXIT_FAILURE;
+            }
+            lenRef = nffts[n] % 2 == 0 ? nffts[n] / 2 + 1
+                                       : (nffts[n] + 1) / 2;
+
+            peak = 0.0;
+            for (k = 0; k < lenRef; ++k) {
+                if (Pref[k] > peak) {
+                    peak = Pref[k];
+                }
+            }
+
+            for (path = 0; path < NUM_PATHS; ++path) {
+                /* Time the path */
+                elapsed = 0.0;
+                for (r = 0; r < NUM_REPEAT; ++r) {
+                    status = runPath(&paths[path], signal, LEN_SIGNAL,
+                                     nffts[n], &Pxx, &lenPxx, &seconds);
+                    if (status != WELCH_SUCCESS) {
+                        break;
+                    }
+                    elapsed += seconds;
+                    if (r < NUM_REPEAT - 1) {
+                        free(Pxx);
+                    }
+                }
+
+                if (status != WELCH_SUCCESS || lenPxx != lenRef) {
+                    printf("%-9s %5d %-12s %10s %10s %10s %14s %s\n",
+                           signalNames[type], nffts[n], paths[path].name,
+                           "-", "-", "-", "-",
+                           paths[path].optional ? "SKIPPED" : "FAILED");
+                    if (status == WELCH_SUCCESS) {
+                        free(Pxx);
+                    }
+                    if (!paths[path].optional) {
+                        failed = 1;
+                    }
+                    continue;
+                }
+
+                throughput = (double) LEN_SIGNAL * NUM_REPEAT / elapsed;
+
+                /* Compare with the reference */
+                maxError = 0.0;
+                relError = 0.0;
+                sum = 0.0L;
+                for (k = 0; k < lenPxx; ++k) {
+                    error = fabsl(Pxx[k] - Pref[k]);
+                    if (error / peak > maxError) {
+                        maxError = error / peak;
+                    }
+                    /* Bins far below the peak only carry rounding noise */
+                    if (Pref[k] > 1e-6 * peak && error / Pref[k] > relError) {
+                        relError = error / Pref[k];
+                    }
+                    sum += Pxx[k];
+                }
+
+                /* Parseval's theorem, for even and odd nfft */
+                sum *= SAMPLING_FREQUENCY / nffts[n];
+                parsevalError = fabsl(sum - energy) / energy;
+
+                printf("%-9s %5d %-12s %10.3e %10.3e %10.3e %14.0f %s\n",
+                       signalNames[type], nffts[n], paths[path].name,
+                       maxError, relError, parsevalError, throughput,
+                       maxError <= paths[path].tolerance
+                       && parsevalError <= paths[path].tolerance
+                       ? "OK" : "FAILED");
+
+                if (maxError > paths[path].tolerance
+                    || parsevalError > paths[path].tolerance) {
+                    failed = 1;
+                }
+
+                free(Pxx);
+            }
+        }
+    }
+
+    if (!validateDecimation()) {
+        failed = 1;
+    }
+
+    if (!validateTapers()) {
+        failed = 1;
+    }
+
+    remove(PROFILE);
+    free(signal);
+    free(Pref);
+
+    if (failed) {
+        printf("Validation failed.\n");
+
+        return EXIT_FAILURE;
+    }
+
+    printf("Validation passed.\n");
+
+    return EXIT_SUCCESS;
+}
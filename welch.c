@@ -8,11 +8,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <omp.h>
 #include "welch.h"
 
 #define FFTW 0
 #define FFTW_OPENMP 1
 #define CUFFT 2
+#define FFTW_NUMA 3
 
 welchStatus_t welch(double *signal, double **Pxx, double **frequency,
                     double samplingFrequency, int lenSignal, int lenSegment,
@@ -24,7 +26,7 @@ welchStatus_t welch(double *signal, double **Pxx, double **frequency,
                                    variable so that Pxx is not touched if some
                                    error occurs. */
     double *frequencyInternal;  /* Similar purpose, but for frequency */
-    double lenPxxInternal;      /* Similar purpose, but for lenPxx */
+    int lenPxxInternal;         /* Similar purpose, but for lenPxx */
     int numSegment;             /* Number of segments */
     double scale;               /* Scale for Pxx */
     double *window;             /* Array representing the window function */
@@ -33,6 +35,9 @@ welchStatus_t welch(double *signal, double **Pxx, double **frequency,
     int fftCall;                /* Type of FFT implementation to call */
     int i, j;                   /* Loop indices */
     int status;                 /* Function status */
+    welchProfile_t profile;     /* Tuned configuration for fftType "auto" */
+    int maxThreads;             /* Threads of the caller, restored after a
+                                   tuned run */
 
     /* Check inputs */
     if (samplingFrequency <= 0) {
@@ -79,21 +84,36 @@ welchStatus_t welch(double *signal, double **Pxx, double **frequency,
         return WELCH_FAILURE;
     }
 
-    /* Get window function */
-    if (strcmp(windowType, "rectangular") == 0) {
-        window = (double*) malloc(lenSignal * sizeof(double));
+    /* Run the tuned configuration of these parameters */
+    if (strcmp(fftType, "auto") == 0) {
+        if (welchLookupProfile(welchProfilePath(), lenSignal, lenSegment,
+                               lenOverlap, windowType, nfft, &profile)
+            != WELCH_SUCCESS) {
+            return welch(signal, Pxx, frequency, samplingFrequency, lenSignal,
+                         lenSegment, lenOverlap, lenPxx, windowType, "fftw",
+                         nfft);
+        }
 
-        if (window == NULL) {
-            fprintf(stderr, "Failed to allocate memory in Welch method.\n");
+        maxThreads = omp_get_max_threads();
+        omp_set_num_threads(profile.numThreads);
+        status = welch(signal, Pxx, frequency, samplingFrequency, lenSignal,
+                       lenSegment, lenOverlap, lenPxx, windowType,
+                       profile.fftType, profile.nfft);
+        omp_set_num_threads(maxThreads);
 
-            return WELCH_FAILURE;
-        }
+        return status;
+    }
 
-        for (i = 0; i < lenSignal; ++i) {
-            window[i] = 1.0;
-        }
-    } else {
-        fprintf(stderr, "Unrecoginzed type of window function.\n");
+    /* Get window function */
+    window = (double*) malloc(lenSegment * sizeof(double));
+    if (window == NULL) {
+        fprintf(stderr, "Failed to allocate memory in Welch method.\n");
+
+        return WELCH_FAILURE;
+    }
+
+    if (getWindow(windowType, window, lenSegment) != WELCH_SUCCESS) {
+        free(window);
 
         return WELCH_FAILURE;
     }
@@ -104,6 +124,8 @@ welchStatus_t welch(double *signal, double **Pxx, double **frequency,
         fftCall = FFTW_OPENMP;
     } else if (strcmp(fftType, "cufft") == 0) {
         fftCall = CUFFT;
+    } else if (strcmp(fftType, "fftw_numa") == 0) {
+        fftCall = FFTW_NUMA;
     } else {
         fprintf(stderr, "Error in welch(): Unrecoginzed FFT implementation.\n");
 
@@ -183,21 +205,10 @@ welchStatus_t welch(double *signal, double **Pxx, double **frequency,
     }
     scale = 1.0 / (samplingFrequency * normSquared);
 
-    /* Compute FFT of each segment, and add squared sums to Pxx */
-    for (i = 0; i + lenSegment <= lenSignal; i += lenSegment - lenOverlap) {
-        /* Convolve the current segment with window */
-        for (j = 0; j < lenSegment; ++j) {
-            windowedSignal[j] = signal[i + j] * window[j];
-        }
-
-        /* Compute FFT of the convolved signal */
-        if (fftCall == FFTW) {
-            status = fftw(windowedSignal, lenSegment, signalfft, nfft, 0);
-        } else if (fftCall == FFTW_OPENMP) {
-            status = fftw(windowedSignal, lenSegment, signalfft, nfft, 1);
-        } else {
-            status = cufft(windowedSignal, lenSegment, signalfft, nfft);
-        }
+    if (fftCall == FFTW_NUMA) {
+        /* Segments are computed in parallel with node-local buffers */
+        status = welchNuma(signal, window, lenSignal, lenSegment, lenOverlap,
+                           nfft, PxxInternal);
 
         if (status == WELCH_FAILURE) {
             free(signalfft);
@@ -208,30 +219,42 @@ welchStatus_t welch(double *signal, double **Pxx, double **frequency,
 
             return WELCH_FAILURE;
         }
+    } else {
+        /* Compute FFT of each segment, and add squared sums to Pxx */
+        for (i = 0; i + lenSegment <= lenSignal;
+             i += lenSegment - lenOverlap) {
+            /* Convolve the current segment with window */
+            for (j = 0; j < lenSegment; ++j) {
+                windowedSignal[j] = signal[i + j] * window[j];
+            }
 
-        /* Add the squared magnitude of FFT to Pxx */
-        PxxInternal[0] += signalfft[0] * signalfft[0];
-        for (j = 1; j < lenPxxInternal; ++j) {
-            if (nfft % 2 == 0 && j == lenPxxInternal - 1) {
-                /* If nfft is even, the last term is real does not have a
-                 * corresponding imaginary term */
-                PxxInternal[j] += signalfft[nfft - 1] * signalfft[nfft - 1];
+            /* Compute FFT of the convolved signal */
+            if (fftCall == FFTW) {
+                status = fftw(windowedSignal, lenSegment, signalfft, nfft, 0);
+            } else if (fftCall == FFTW_OPENMP) {
+                status = fftw(windowedSignal, lenSegment, signalfft, nfft, 1);
             } else {
-                PxxInternal[j] += signalfft[2 * j - 1] * signalfft[2 * j - 1]
-                                  + signalfft[2 * j] * signalfft[2 * j];
+                status = cufft(windowedSignal, lenSegment, signalfft, nfft);
+            }
+
+            if (status == WELCH_FAILURE) {
+                free(signalfft);
+                free(PxxInternal);
+                free(frequencyInternal);
+                free(window);
+                free(windowedSignal);
+
+                return WELCH_FAILURE;
             }
+
+            /* Add the squared magnitude of FFT to Pxx */
+            addPeriodogram(signalfft, nfft, PxxInternal);
         }
     }
 
     /* Scale Pxx and average it over number of segments */
     numSegment = (lenSignal - lenOverlap) / (lenSegment - lenOverlap);
-    for (i = 0; i < lenPxxInternal; ++i) {
-        if (i == 0 || i == lenPxxInternal - 1) {
-            PxxInternal[i] *= scale / numSegment;
-        } else {
-            PxxInternal[i] *= scale * 2 / numSegment;
-        }
-    }
+    scalePeriodogram(PxxInternal, nfft, scale / numSegment);
 
     /* Get frequencies */
     for (i = 0; i < lenPxxInternal; ++i) {
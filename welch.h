@@ -9,6 +9,10 @@
 
 #include <stddef.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * Function return status
  */
@@ -29,7 +33,11 @@ typedef enum {
  * lenPxx - length of spectral density estimate, determined by this function
  * windowType - type of window function to apply
  *              (only rectangular window can be used at this time)
- * fftType - type of FFT implementation to use
+ * fftType - type of FFT implementation to use: "fftw", "fftw_openmp",
+ *           "cufft", "fftw_numa" to compute segments in parallel on
+ *           threads pinned to NUMA nodes, or "auto" to use the configuration
+ *           stored by welchTune() for these parameters, which may have a
+ *           larger nfft. "auto" falls back to "fftw" for untuned parameters.
  * nfft - number of points to do FFT
  *
  * Returns a welchStatus_t
@@ -39,6 +47,302 @@ welchStatus_t welch(double *signal, double **Pxx, double **frequency,
                     int lenOverlap, int *lenPxx, char *windowType,
                     char *fftType, int nfft);
 
+/**
+ * The Welch method with a polyphase decimator in front of segmentation. The
+ * signal is low-pass filtered and downsampled by decimationFactor, and the
+ * spectral density is estimated at the reduced sampling rate. Useful when only
+ * the low end of the spectrum is of interest.
+ * lenSegment, lenOverlap and nfft are counted in samples at the reduced rate,
+ * and samplingFrequency is the rate of the original signal. Other arguments
+ * are the same as in welch().
+ * Only frequencies up to 80% of the reduced Nyquist frequency, where the
+ * decimation filter is flat and free of aliases, are returned, so lenPxx is
+ * smaller than for welch() with the same nfft. A decimationFactor of 1
+ * applies no filter and returns the whole band, like welch().
+ *
+ * Returns a welchStatus_t
+ */
+welchStatus_t welchDecimated(double *signal, double **Pxx, double **frequency,
+                             double samplingFrequency, int lenSignal,
+                             int lenSegment, int lenOverlap, int *lenPxx,
+                             char *windowType, char *fftType, int nfft,
+                             int decimationFactor);
+
+/**
+ * Counters reported by welchFile()
+ */
+typedef struct {
+    long readerStalls;        /* Times the reader waited for a free block */
+    long computeStalls;       /* Times the compute stage waited for data */
+    double readerStallTime;   /* Seconds the reader waited, sleeping or not */
+    double computeStallTime;  /* Seconds the compute stage waited, likewise */
+    double readTime;          /* Seconds spent reading the file */
+    double computeTime;       /* Seconds spent computing segments */
+    double totalTime;         /* Wall time of the pipeline */
+} welchPipelineStats_t;
+
+/**
+ * The Welch method for a signal stored in a file as raw doubles. Reading the
+ * file and computing segments run concurrently, on a reader thread started
+ * by this function and on the calling thread, so the wall time approaches
+ * the larger of the two instead of their sum. May be called from inside an
+ * OpenMP parallel region.
+ * path - file containing the signal
+ * lenBlock - number of samples read at once, rounded up to a multiple of
+ *            lenSegment - lenOverlap
+ * stats - time and stall counters of the two stages. May be NULL.
+ * fftType - "fftw" or "fftw_openmp"
+ * Other arguments are the same as in welch(), and the length of the signal
+ * is given by the size of the file.
+ *
+ * Returns a welchStatus_t
+ */
+welchStatus_t welchFile(char *path, double **Pxx, double **frequency,
+                        double samplingFrequency, int lenSegment,
+                        int lenOverlap, int *lenPxx, char *windowType,
+                        char *fftType, int nfft, int lenBlock,
+                        welchPipelineStats_t *stats);
+
+/**
+ * Default profile file of the auto-tuner, used unless the environment
+ * variable WELCH_PROFILE names another one
+ */
+#define WELCH_PROFILE_DEFAULT "welch.profile"
+
+/**
+ * Configuration chosen by the auto-tuner
+ */
+typedef struct {
+    char fftType[16];  /* FFT implementation passed to welch() */
+    int numThreads;    /* Number of OpenMP threads */
+    int nfft;          /* Number of FFT points, possibly zero-padded */
+} welchProfile_t;
+
+/**
+ * Benchmark the FFT implementations and thread counts for a set of welch()
+ * parameters, and store the fastest configuration in a profile file. Later
+ * calls of welch() with the same parameters and fftType "auto" use it.
+ * allowPadding - 1 to also try nfft rounded up to the next 2^a 3^b 5^c,
+ *                which changes the frequencies of the estimate
+ * profilePath - profile file to update, usually welchProfilePath()
+ * best - the chosen configuration. May be NULL.
+ * Other arguments are the same as in welch().
+ *
+ * Returns a welchStatus_t
+ */
+welchStatus_t welchTune(double *signal, double samplingFrequency,
+                        int lenSignal, int lenSegment, int lenOverlap,
+                        char *windowType, int nfft, int allowPadding,
+                        char *profilePath, welchProfile_t *best);
+
+/**
+ * Look up the configuration stored for a set of welch() parameters
+ *
+ * Returns WELCH_FAILURE if the parameters have not been tuned
+ */
+welchStatus_t welchLookupProfile(char *profilePath, int lenSignal,
+                                 int lenSegment, int lenOverlap,
+                                 char *windowType, int nfft,
+                                 welchProfile_t *profile);
+
+/**
+ * Profile file used by welch(): $WELCH_PROFILE or WELCH_PROFILE_DEFAULT
+ */
+char *welchProfilePath(void);
+
+/**
+ * Smallest integer not less than n whose only prime factors are 2, 3 and 5
+ */
+int fastFftSize(int n);
+
+/**
+ * Thomson's multitaper method for real signals. The whole signal is tapered
+ * by numTaper discrete prolate spheroidal sequences, and the power spectra of
+ * the tapered copies, computed by one batched FFT, are averaged. The tapers
+ * and the FFT plan are cached between calls with the same parameters, so
+ * this function is not thread safe. multitaperCleanup() releases them.
+ * halfBandwidth - time half-bandwidth product NW. The resolution bandwidth
+ *                 is 2 * NW * samplingFrequency / lenSignal.
+ * numTaper - number of tapers K, usually at most 2 * NW - 1
+ * adaptive - 1 to combine eigenspectra with Thomson's adaptive weights, 0 to
+ *            average them with equal weights
+ * fftType - "fftw" or "fftw_openmp"
+ * nfft - number of points to do FFT, at least lenSignal
+ * Other arguments are the same as in welch().
+ *
+ * Returns a welchStatus_t
+ */
+welchStatus_t multitaper(double *signal, double **Pxx, double **frequency,
+                         double samplingFrequency, int lenSignal,
+                         int *lenPxx, double halfBandwidth, int numTaper,
+                         int adaptive, char *fftType, int nfft);
+
+/**
+ * Release the tapers and FFT plan cached by multitaper()
+ */
+void multitaperCleanup(void);
+
+/**
+ * Discrete prolate spheroidal sequences
+ * lenSignal - length of each sequence
+ * halfBandwidth - time half-bandwidth product NW
+ * numTaper - number of sequences, in decreasing order of concentration
+ * tapers - numTaper arrays of lenSignal, stored one after another. Every
+ *          sequence has unit energy.
+ * lambda - concentration of each sequence in [-NW / lenSignal, NW /
+ *          lenSignal]. May be NULL.
+ *
+ * Returns a welchStatus_t
+ */
+welchStatus_t dpss(int lenSignal, double halfBandwidth, int numTaper,
+                   double *tapers, double *lambda);
+
+/**
+ * Incremental Welch method. The periodogram of every segment is cached with a
+ * hash of its samples, so that after an edit of the signal only the segments
+ * overlapping the edited range, and whose samples actually changed, are
+ * recomputed.
+ */
+typedef struct welchCache_s welchCache_t;
+
+/**
+ * Compute and cache the periodograms of all segments of a signal
+ * cache - the created cache
+ * Other arguments are the same as in welch().
+ *
+ * Returns a welchStatus_t
+ */
+welchStatus_t welchCacheCreate(welchCache_t **cache, double *signal,
+                               double samplingFrequency, int lenSignal,
+                               int lenSegment, int lenOverlap,
+                               char *windowType, int nfft);
+
+/**
+ * Update the cache after the signal was edited
+ * signal - the edited signal, of the same length as when the cache was
+ *          created
+ * dirtyStart, dirtyEnd - the edited samples are in [dirtyStart, dirtyEnd)
+ * numRecomputed - number of segments recomputed. May be NULL.
+ *
+ * Returns a welchStatus_t
+ */
+welchStatus_t welchCacheUpdate(welchCache_t *cache, double *signal,
+                               int dirtyStart, int dirtyEnd,
+                               int *numRecomputed);
+
+/**
+ * Get the spectral density estimate of the cached signal. Pxx and frequency
+ * are allocated as in welch().
+ *
+ * Returns a welchStatus_t
+ */
+welchStatus_t welchCacheGetPxx(welchCache_t *cache, double **Pxx,
+                               double **frequency, int *lenPxx);
+
+/**
+ * Release a cache
+ */
+void welchCacheDestroy(welchCache_t *cache);
+
+/**
+ * Real-time mode of the Welch method. An acquisition thread pushes blocks of
+ * lenSegment - lenOverlap samples, and a consumer thread started by
+ * welchRealtimeCreate() averages the periodograms of segments starting at
+ * multiples of lenSegment - lenOverlap, as welch() does, each one as soon as
+ * its last sample is pushed. Neither pushing a block nor updating Pxx
+ * allocates memory, takes a lock or makes a system call.
+ */
+typedef struct welchRealtime_s welchRealtime_t;
+
+/**
+ * Create a real-time Welch estimator and start its consumer thread
+ * rt - the created estimator
+ * numBlock - capacity of the ring between producer and consumer in blocks,
+ *            rounded up to a power of 2
+ * deadline - latency in seconds from the push of a block to the update of
+ *            Pxx above which an update counts as an overrun
+ * idle - seconds the consumer sleeps after polling an empty ring for a
+ *        while. Latencies then include the wake-up, up to this long plus the
+ *        timer slack of the system. 0 keeps the consumer spinning, which
+ *        gives the lowest latency but occupies a CPU.
+ * Other arguments are the same as in welch().
+ *
+ * Returns a welchStatus_t
+ */
+welchStatus_t welchRealtimeCreate(welchRealtime_t **rt,
+                                  double samplingFrequency, int lenSegment,
+                                  int lenOverlap, char *windowType, int nfft,
+                                  int numBlock, double deadline, double idle);
+
+/**
+ * Push a block of lenSegment - lenOverlap samples. Must be called from a
+ * single thread. If the ring is full the block is dropped and counted, and
+ * the next segment starts right after the gap.
+ *
+ * Returns WELCH_FAILURE if the block is dropped
+ */
+welchStatus_t welchRealtimePush(welchRealtime_t *rt, double *block);
+
+/**
+ * Copy the current spectral density estimate, averaged over all segments
+ * seen so far. May be called from any thread while samples are pushed.
+ * Pxx - array of welchRealtimeLenPxx(rt) receiving the estimate
+ * frequency - array of the same length receiving frequencies. May be NULL.
+ * numSegment - number of averaged segments. May be NULL.
+ *
+ * Returns WELCH_FAILURE if no segment is complete yet
+ */
+welchStatus_t welchRealtimeGetPxx(welchRealtime_t *rt, double *Pxx,
+                                  double *frequency, long *numSegment);
+
+/**
+ * Length of the spectral density estimate
+ */
+int welchRealtimeLenPxx(welchRealtime_t *rt);
+
+/**
+ * Latency from the push of a block to the update of Pxx, in seconds, below
+ * which the given percentage of updates fall. The value is rounded up to the
+ * top of a histogram bucket, so it may be up to about 6% too high but never
+ * too low, and it never exceeds the maximum. A percentile of 100 returns the
+ * exact maximum.
+ */
+double welchRealtimeLatency(welchRealtime_t *rt, double percentile);
+
+/**
+ * Get the counters of a real-time estimator
+ * numUpdate - number of updates of Pxx
+ * overruns - number of updates later than the deadline
+ * dropped - number of blocks dropped because the ring was full
+ */
+void welchRealtimeCounters(welchRealtime_t *rt, long *numUpdate,
+                           long *overruns, long *dropped);
+
+/**
+ * Stop the consumer thread and release a real-time estimator
+ */
+void welchRealtimeDestroy(welchRealtime_t *rt);
+
+/**
+ * NUMA-aware computation of the segments of the Welch method, used by welch()
+ * for fftType "fftw_numa". Threads are pinned to NUMA nodes in contiguous
+ * groups and each one processes a contiguous run of segments. The part of
+ * the signal, the scratch buffers and the partial Pxx of a thread are first
+ * touched by that thread so they live on its node. Partial results are
+ * reduced within each node, then across nodes. Only the nodes this process
+ * may allocate on are used, and every thread gets its affinity back before
+ * returning. On a single node no thread is pinned and the signal is not
+ * copied.
+ * signal - input signal
+ * window - window function of length lenSegment
+ * Pxx - sum of the periodograms of all segments is added to this array
+ * Other arguments are the same as in welch().
+ *
+ * Returns a welchStatus_t
+ */
+welchStatus_t welchNuma(double *signal, double *window, int lenSignal,
+                        int lenSegment, int lenOverlap, int nfft, double *Pxx);
+
 /**
  * FFT routine wrappers
  * x - input data
@@ -52,6 +356,58 @@ welchStatus_t welch(double *signal, double **Pxx, double **frequency,
 welchStatus_t fftw(double *x, int n, double *xfft, int nfft, int useOpenMP);
 welchStatus_t cufft(double *x, int n, double *xfft, int nfft);
 
+/**
+ * FFTW plan that is created once and executed many times, which avoids the
+ * planning and allocation done by every call of fftw(). A plan may hold a
+ * batch of howmany transforms of the same size.
+ */
+typedef struct {
+    void *plan;   /* The fftw_plan */
+    double *in;   /* Input buffer of howmany * nfft points */
+    void *out;    /* Output buffer of howmany * (nfft / 2 + 1) fftw_complex */
+    int nfft;     /* Length of a single FFT */
+    int howmany;  /* Number of transforms done by one execution */
+} fftwPlan_t;
+
+/**
+ * Create an FFTW plan. Like every FFTW planner call, this function is not
+ * thread safe.
+ * plan - the plan to initialize
+ * nfft - length of a single FFT
+ * howmany - number of transforms done by one execution
+ * useOpenMP - enable OpenMP in fftw. 1 for yes, 0 for no
+ *
+ * Returns a welchStatus_t
+ */
+welchStatus_t fftwCreatePlan(fftwPlan_t *plan, int nfft, int howmany,
+                             int useOpenMP);
+
+/**
+ * Execute an FFTW plan. Does not allocate memory, and different plans may be
+ * executed concurrently.
+ * plan - plan created by fftwCreatePlan()
+ * x - howmany input arrays of length n, stored one after another
+ * n - length of a single input array, zero-padded to nfft
+ * xfft - howmany transformed arrays of length nfft, in the same layout as
+ *        the output of fftw()
+ *
+ * Returns a welchStatus_t
+ */
+welchStatus_t fftwExecute(fftwPlan_t *plan, double *x, int n, double *xfft);
+
+/**
+ * Execute an FFTW plan on the input the caller has written into plan->in,
+ * including the zero padding, which saves the copy done by fftwExecute()
+ * plan - plan created by fftwCreatePlan()
+ * xfft - same as in fftwExecute()
+ */
+void fftwExecuteInput(fftwPlan_t *plan, double *xfft);
+
+/**
+ * Release the memory held by an FFTW plan
+ */
+void fftwDestroyPlan(fftwPlan_t *plan);
+
 /* Utility functions */
 
 /**
@@ -75,4 +431,43 @@ welchStatus_t getWindow(char *windowType, double *window, int lenWindow);
  */
 welchStatus_t padZero(double *x, int n, double **xPadded, int nPadded);
 
+/**
+ * Add the squared magnitude of a Fourier transformed segment to an unscaled
+ * spectral density estimate
+ * xfft - Fourier transformed data, in the layout returned by fftw()
+ * nfft - length of FFT
+ * Pxx - spectral density estimate of length nfft / 2 + 1 for even nfft, or
+ *       (nfft + 1) / 2 for odd nfft
+ */
+void addPeriodogram(double *xfft, int nfft, double *Pxx);
+
+/**
+ * Turn summed periodograms into a one-sided spectral density estimate
+ * Pxx - spectral density estimate of length nfft / 2 + 1 for even nfft and
+ *       (nfft + 1) / 2 for odd nfft
+ * nfft - number of FFT points
+ * scale - scale of DC and, for even nfft, of Nyquist, usually
+ *         1 / (samplingFrequency * normSquared(window) * numSegment).
+ *         Other frequencies, including the last one for odd nfft, are
+ *         scaled by twice this value.
+ */
+void scalePeriodogram(double *Pxx, int nfft, double scale);
+
+/**
+ * Low-pass filter and downsample an array by an integer factor. Factors larger
+ * than 8 are split into a cascade of smaller stages.
+ * x - array to be decimated
+ * n - size of x
+ * factor - decimation factor. 1 returns a copy of x.
+ * y - decimated x, allocated by this function
+ * lenY - size of y, which is n / factor
+ *
+ * Returns a welchStatus_t
+ */
+welchStatus_t decimate(double *x, int n, int factor, double **y, int *lenY);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -0,0 +1,252 @@
+/**
+ * File: welch.hpp
+ * Description: Header-only C++ interface of the Welch method for
+ *              configurations known at compile time. Segment length, overlap,
+ *              nfft, window and FFT backend are template parameters, so the
+ *              window table and scale factor are computed by the compiler,
+ *              buffers are statically sized and the accumulation of Pxx is
+ *              specialized for even and odd nfft. FFTs are done by the C
+ *              routines declared in welch.h. Requires C++14.
+ *
+ * Author: Xiaojun Wu <xiaojun.wu@nyu.edu>
+ */
+#ifndef WELCH_HPP
+#define WELCH_HPP
+
+#include <array>
+#include <cstdio>
+#include "welch.h"
+
+namespace welchpp {
+
+/**
+ * Window functions. A window is a type with a constexpr member function
+ * value(i, n) returning the i-th point of a window of length n.
+ */
+struct Rectangular {
+    static constexpr double value(int, int) { return 1.0; }
+};
+
+namespace detail {
+
+/* FFTW backend holding a plan, created on the first transform, so that no
+ * memory is allocated and no plan is made per segment */
+template <int UseOpenMP>
+class PlannedFftw {
+public:
+    PlannedFftw() : created_(false) {}
+
+    PlannedFftw(const PlannedFftw&) = delete;
+    PlannedFftw& operator=(const PlannedFftw&) = delete;
+
+    ~PlannedFftw()
+    {
+        if (created_) {
+            fftwDestroyPlan(&plan_);
+        }
+    }
+
+    welchStatus_t transform(double *x, int n, double *xfft, int nfft)
+    {
+        if (!created_) {
+            if (fftwCreatePlan(&plan_, nfft, 1, UseOpenMP) != WELCH_SUCCESS) {
+                return WELCH_FAILURE;
+            }
+            created_ = true;
+        }
+
+        return fftwExecute(&plan_, x, n, xfft);
+    }
+
+private:
+    fftwPlan_t plan_;
+    bool created_;
+};
+
+}  // namespace detail
+
+/**
+ * FFT backends. A backend is a type with a member function
+ * transform(x, n, xfft, nfft) following the FFT routine wrappers in welch.h.
+ * The FFTW backends keep their plan for the lifetime of the Welch object.
+ */
+using Fftw = detail::PlannedFftw<0>;
+using FftwOpenMP = detail::PlannedFftw<1>;
+
+struct Cufft {
+    welchStatus_t transform(double *x, int n, double *xfft, int nfft)
+    {
+        return cufft(x, n, xfft, nfft);
+    }
+};
+
+namespace detail {
+
+/* Window function tabulated at compile time */
+template <class Window, int Len>
+struct WindowTable {
+    double values[Len];
+
+    constexpr WindowTable() : values()
+    {
+        for (int i = 0; i < Len; ++i) {
+            values[i] = Window::value(i, Len);
+        }
+    }
+
+    constexpr double normSquared() const
+    {
+        double sum = 0.0;
+
+        for (int i = 0; i < Len; ++i) {
+            sum += values[i] * values[i];
+        }
+
+        return sum;
+    }
+};
+
+/* Add the squared magnitude of an FFT result, in the real layout returned by
+ * the FFT routine wrappers, to Pxx */
+template <int Nfft, bool Even = (Nfft % 2 == 0)>
+struct Accumulate;
+
+template <int Nfft>
+struct Accumulate<Nfft, true> {
+    static constexpr int lenPxx = Nfft / 2 + 1;
+
+    static void add(const double *xfft, double *Pxx)
+    {
+        Pxx[0] += xfft[0] * xfft[0];
+        for (int j = 1; j < lenPxx - 1; ++j) {
+            Pxx[j] += xfft[2 * j - 1] * xfft[2 * j - 1]
+                      + xfft[2 * j] * xfft[2 * j];
+        }
+        /* The last term is real and has no imaginary part */
+        Pxx[lenPxx - 1] += xfft[Nfft - 1] * xfft[Nfft - 1];
+    }
+};
+
+template <int Nfft>
+struct Accumulate<Nfft, false> {
+    static constexpr int lenPxx = (Nfft + 1) / 2;
+
+    static void add(const double *xfft, double *Pxx)
+    {
+        Pxx[0] += xfft[0] * xfft[0];
+        for (int j = 1; j < lenPxx; ++j) {
+            Pxx[j] += xfft[2 * j - 1] * xfft[2 * j - 1]
+                      + xfft[2 * j] * xfft[2 * j];
+        }
+    }
+};
+
+}  // namespace detail
+
+/**
+ * The Welch method with a fixed configuration
+ * Nfft - number of points to do FFT
+ * SegLen - length of a single segment of signals
+ * Overlap - length of overlap for two consecutive segments
+ * Window - type of window function to apply
+ * Backend - FFT implementation to use
+ */
+template <int Nfft, int SegLen, int Overlap, class Window = Rectangular,
+          class Backend = Fftw>
+class Welch {
+    static_assert(Nfft > 0, "Number of FFT points must be positive.");
+    static_assert(SegLen > 0, "Length of segment must be positive.");
+    static_assert(SegLen <= Nfft, "Length of segment must not exceed nfft.");
+    static_assert(Overlap >= 0,
+                  "Number of overlapping points must be non-negative.");
+    static_assert(Overlap < SegLen,
+                  "Length of overlap must be smaller than length of segment.");
+
+public:
+    /* Length of spectral density estimate */
+    static constexpr int lenPxx = detail::Accumulate<Nfft>::lenPxx;
+
+    /* Distance between the starts of two consecutive segments */
+    static constexpr int hop = SegLen - Overlap;
+
+    /**
+     * Estimate the spectral density
+     * signal - input signal
+     * lenSignal - length of the signal array / number of samples
+     * samplingFrequency - sampling frequency of the signal
+     * Pxx - spectral density estimate, an array of lenPxx supplied by caller
+     * frequency - frequencies where the spectral density is estimated, an
+     *             array of lenPxx supplied by caller. May be NULL.
+     *
+     * Returns a welchStatus_t. Pxx is not touched if some error occurs.
+     */
+    welchStatus_t operator()(const double *signal, int lenSignal,
+                             double samplingFrequency, double *Pxx,
+                             double *frequency = nullptr)
+    {
+        static constexpr detail::WindowTable<Window, SegLen> window{};
+        static constexpr double normSquared = window.normSquared();
+        double scale;
+        int numSegment;
+
+        if (samplingFrequency <= 0) {
+            std::fprintf(stderr, "Sampling frequency of signal must be "
+                         "positive.\n");
+
+            return WELCH_FAILURE;
+        }
+
+        if (lenSignal < SegLen || (lenSignal - Overlap) % hop != 0) {
+            std::fprintf(stderr, "Unable to determine integral number of "
+                         "segments.\n");
+
+            return WELCH_FAILURE;
+        }
+
+        PxxInternal_.fill(0.0);
+
+        for (int i = 0; i + SegLen <= lenSignal; i += hop) {
+            for (int j = 0; j < SegLen; ++j) {
+                windowedSignal_[j] = signal[i + j] * window.values[j];
+            }
+
+            if (backend_.transform(windowedSignal_.data(), SegLen,
+                                   signalfft_.data(), Nfft) != WELCH_SUCCESS) {
+                return WELCH_FAILURE;
+            }
+
+            detail::Accumulate<Nfft>::add(signalfft_.data(),
+                                          PxxInternal_.data());
+        }
+
+        /* Scale Pxx and average it over number of segments */
+        numSegment = (lenSignal - Overlap) / hop;
+        scale = 1.0 / (samplingFrequency * normSquared * numSegment);
+        Pxx[0] = PxxInternal_[0] * scale;
+        for (int i = 1; i <= (Nfft - 1) / 2; ++i) {
+            Pxx[i] = PxxInternal_[i] * scale * 2;
+        }
+        /* Only the Nyquist frequency of an even Nfft has no counterpart */
+        if (Nfft % 2 == 0) {
+            Pxx[Nfft / 2] = PxxInternal_[Nfft / 2] * scale;
+        }
+
+        if (frequency != nullptr) {
+            for (int i = 0; i < lenPxx; ++i) {
+                frequency[i] = i * samplingFrequency / Nfft;
+            }
+        }
+
+        return WELCH_SUCCESS;
+    }
+
+private:
+    Backend backend_;
+    std::array<double, SegLen> windowedSignal_;
+    std::array<double, Nfft> signalfft_;
+    std::array<double, lenPxx> PxxInternal_;
+};
+
+}  // namespace welchpp
+
+#endif